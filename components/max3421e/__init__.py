@@ -1,6 +1,17 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.const import CONF_ID, CONF_DEBUG
+import esphome.final_validate as fv
+from esphome import automation, pins
+from esphome.const import (
+    CONF_ID,
+    CONF_SIZE,
+    CONF_DEBUG,
+    CONF_PORT,
+    CONF_CLK_PIN,
+    CONF_MISO_PIN,
+    CONF_MOSI_PIN,
+    CONF_TRIGGER_ID,
+)
 from esphome.core import CORE
 
 LIB_DEPENDENCIES = [
@@ -8,6 +19,10 @@ LIB_DEPENDENCIES = [
     ["felis/USB-Host-Shield-20", "~1.6.0"]
 ]
 
+AUTO_LOAD = ["json"]
+
+DOMAIN = "max3421e"
+
 CONF_MAX3421E_ID = "max3421e_id"
 
 max3421e_ns = cg.esphome_ns.namespace("max3421e")
@@ -15,23 +30,166 @@ MAX3421EComponent = max3421e_ns.class_(
     "MAX3421EComponent", cg.Component
 )
 
+SPIBackendType = max3421e_ns.enum("SPIBackendType")
+SPI_BACKENDS = {
+    "ARDUINO": SPIBackendType.SPI_BACKEND_ARDUINO,
+    "ESP_IDF": SPIBackendType.SPI_BACKEND_ESP_IDF,
+}
+DeviceCacheStorage = max3421e_ns.enum("DeviceCacheStorage")
+DEVICE_CACHE_STORAGES = {
+    "FLASH": DeviceCacheStorage.DEVICE_CACHE_STORAGE_FLASH,
+    "RTC": DeviceCacheStorage.DEVICE_CACHE_STORAGE_RTC,
+}
+DeviceTreeFormat = max3421e_ns.enum("DeviceTreeFormat")
+DEVICE_TREE_FORMATS = {
+    "JSON": DeviceTreeFormat.DEVICE_TREE_FORMAT_JSON,
+    "BINARY": DeviceTreeFormat.DEVICE_TREE_FORMAT_BINARY,
+}
+SPI_HOSTS = {
+    "SPI2": cg.RawExpression("SPI2_HOST"),
+    "SPI3": cg.RawExpression("SPI3_HOST"),
+}
+
+DeviceTreeTrigger = max3421e_ns.class_(
+    "DeviceTreeTrigger", automation.Trigger.template(cg.std_string)
+)
+PublishDeviceTreeAction = max3421e_ns.class_(
+    "PublishDeviceTreeAction", automation.Action, cg.Parented.template(MAX3421EComponent)
+)
+
 CONF_REPORT_STATUS_INTERVAL = "report_status_interval"
+CONF_HUBS = "hubs"
+CONF_HUB = "hub"
 CONF_DEBUG_VERBOSE = CONF_DEBUG + "_verbose"
 CONF_DEBUG_USB_LIB = CONF_DEBUG + "_usb_lib"
+CONF_SPI_BACKEND = "spi_backend"
+CONF_SPI_HOST = "spi_host"
+CONF_SPI_BENCHMARK = "spi_benchmark"
+CONF_CLOCK_SPEED = "clock_speed"  # spi clock speed
+CONF_SUSPEND_TIMEOUT = "suspend_timeout"
+CONF_REMOTE_WAKEUP = "remote_wakeup"
+CONF_DEVICE_CACHE = "device_cache"
+CONF_STORAGE = "storage"
+CONF_DEVICE_TREE_FORMAT = "device_tree_format"
+CONF_ON_DEVICE_TREE = "on_device_tree"
+
+# hub port sensors, without a port the sensor reports the device on the root port.
+PORT_SCHEMA = cv.Schema({
+    cv.Optional(CONF_HUB, default=1): cv.int_range(1, 7),  # type: ignore[arg-type]
+    cv.Optional(CONF_PORT): cv.int_range(1, 7),  # type: ignore[arg-type]
+})
+
+
+
+def _default_cs_pin():
+    # slave select the USB library drives itself, see MAX3421E in UsbCore.h
+    if CORE.is_esp8266:
+        return 15
+    if CORE.is_esp32:
+        return 5
+    return 10
 
-CONFIG_SCHEMA = cv.Schema({
+
+def _validate_spi(config):
+    if config[CONF_SPI_BACKEND] == "ESP_IDF":
+        if not CORE.is_esp32:
+            raise cv.Invalid("The esp_idf SPI backend is only available on ESP32", [CONF_SPI_BACKEND])
+        for key in (CONF_CLK_PIN, CONF_MOSI_PIN, CONF_MISO_PIN):
+            if key not in config:
+                raise cv.Invalid(f"{key} is required by the esp_idf SPI backend", [key])
+    elif CONF_SPI_HOST in config:
+        raise cv.Invalid("spi_host is only used by the esp_idf SPI backend", [CONF_SPI_HOST])
+    return config
+
+
+def _validate_device_cache(config):
+    # the RTC memory of the ESP8266 left to components holds a single entry of about 244 bytes
+    if CORE.is_esp8266 and config[CONF_STORAGE] == "RTC" and config[CONF_SIZE] > 1:
+        raise cv.Invalid("storage: rtc holds a single device on ESP8266, set size to 1 or use flash",
+                         [CONF_SIZE])
+    return config
+
+
+def _final_validate(config):
+    # the USB library keeps the enumeration state (task state, bus state, hub reset) in statics shared by all USB
+    # host objects, so a second controller would run the state machine of the first one.
+    controllers = fv.full_config.get()[DOMAIN]
+    if isinstance(controllers, list) and len(controllers) > 1:
+        raise cv.Invalid("The USB library supports a single max3421e controller per node")
+    return config
+
+
+CONFIG_SCHEMA = cv.All(cv.Schema({
     cv.GenerateID(): cv.declare_id(MAX3421EComponent),
     cv.Optional(CONF_REPORT_STATUS_INTERVAL, default="0s"): cv.time_period,  # type: ignore[arg-type]
+    # the usb library supports up to 7 hubs, each needs its own driver instance.
+    cv.Optional(CONF_HUBS, default=1): cv.int_range(0, 7),  # type: ignore[arg-type]
     cv.Optional(CONF_DEBUG, False): cv.boolean,  # type: ignore[arg-type]
     cv.Optional(CONF_DEBUG_VERBOSE, False): cv.boolean,  # type: ignore[arg-type]
     cv.Optional(CONF_DEBUG_USB_LIB, False): cv.boolean,  # type: ignore[arg-type]
-}).extend(cv.COMPONENT_SCHEMA)
+    cv.Optional(CONF_SPI_BACKEND, default="ARDUINO"): cv.enum(SPI_BACKENDS, upper=True),  # type: ignore[arg-type]
+    cv.Optional(CONF_SPI_HOST): cv.enum(SPI_HOSTS, upper=True),  # type: ignore[arg-type]
+    # pins of the arduino backend default to the ones of the platform
+    cv.Optional(CONF_CLK_PIN): pins.internal_gpio_output_pin_number,
+    cv.Optional(CONF_MOSI_PIN): pins.internal_gpio_output_pin_number,
+    cv.Optional(CONF_MISO_PIN): pins.internal_gpio_input_pin_number,
+    # MAX3421E operates up to 26MHz according to the datasheet.
+    cv.Optional(CONF_CLOCK_SPEED, default=26): cv.int_range(1, 26),  # type: ignore[arg-type]
+    # log FIFO throughput and register latency of the backend (and the arduino one) once at boot.
+    cv.Optional(CONF_SPI_BENCHMARK, default=False): cv.boolean,  # type: ignore[arg-type]
+    # suspend the bus after this time without data transferred, 0s never suspends.
+    cv.Optional(CONF_SUSPEND_TIMEOUT, default="0s"): cv.positive_time_period_milliseconds,  # type: ignore[arg-type]
+    # let devices supporting it resume the suspended bus (e.g. on a key press).
+    cv.Optional(CONF_REMOTE_WAKEUP, default=True): cv.boolean,  # type: ignore[arg-type]
+    # remember the infos of known devices, so only the device descriptor and serial are read when attached again.
+    cv.Optional(CONF_DEVICE_CACHE): cv.All(cv.Schema({
+        cv.Optional(CONF_SIZE, default=4): cv.int_range(1, 16),  # type: ignore[arg-type]
+        cv.Optional(CONF_STORAGE, default="FLASH"): cv.enum(  # type: ignore[arg-type]
+            DEVICE_CACHE_STORAGES, upper=True),
+    }), _validate_device_cache),
+    # format of the device tree logged and passed to on_device_tree, json or binary (base64 encoded).
+    cv.Optional(CONF_DEVICE_TREE_FORMAT, default="JSON"): cv.enum(  # type: ignore[arg-type]
+        DEVICE_TREE_FORMATS, upper=True),
+    # called with the whole device tree, e.g. to send it by MQTT which has no length limit.
+    cv.Optional(CONF_ON_DEVICE_TREE): automation.validate_automation({
+        cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(DeviceTreeTrigger),
+    }),
+}).extend(cv.COMPONENT_SCHEMA), _validate_spi)
+
+FINAL_VALIDATE_SCHEMA = _final_validate
 
 
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
 
     cg.add(var.set_report_status_interval(config[CONF_REPORT_STATUS_INTERVAL].total_milliseconds))
+    cg.add(var.set_hubs(config[CONF_HUBS]))
+    cg.add(var.set_spi_backend(config[CONF_SPI_BACKEND]))
+    cg.add(var.set_spi_pins(
+        config.get(CONF_CLK_PIN, -1),
+        config.get(CONF_MOSI_PIN, -1),
+        config.get(CONF_MISO_PIN, -1),
+        # the library drives the slave select it was compiled for, register sequences of the component use it too
+        _default_cs_pin(),
+    ))
+    cg.add(var.set_spi_clock_speed(config[CONF_CLOCK_SPEED] * 1000000))
+    cg.add(var.set_spi_benchmark(config[CONF_SPI_BENCHMARK]))
+    cg.add(var.set_suspend_timeout(config[CONF_SUSPEND_TIMEOUT].total_milliseconds))
+    cg.add(var.set_remote_wakeup(config[CONF_REMOTE_WAKEUP]))
+    if CONF_DEVICE_CACHE in config:
+        cache = config[CONF_DEVICE_CACHE]
+        cg.add(var.set_device_cache(cache[CONF_SIZE], cache[CONF_STORAGE]))
+    cg.add(var.set_device_tree_format(config[CONF_DEVICE_TREE_FORMAT]))
+    for conf in config.get(CONF_ON_DEVICE_TREE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(cg.std_string, "x")], conf)
+    if config[CONF_SPI_BACKEND] == "ESP_IDF":
+        cg.add(var.set_spi_host(config.get(CONF_SPI_HOST, SPI_HOSTS["SPI2"])))
+        # route the SPI accesses of the USB library (USB_SPI in settings.h) through the backend
+        cg.add_build_flag("-DUSE_MAX3421E_IDF_SPI")
+        cg.add_build_flag("-DUSB_SPI=esphome::max3421e::usb_spi")
+        cg.add_build_flag(
+            "-include " + CORE.relative_src_path("esphome", "components", "max3421e", "max3421e_usb_spi.h"))
 
     if config[CONF_DEBUG] != None:
         cg.add(var.set_debug(config[CONF_DEBUG]))
@@ -46,3 +204,16 @@ async def to_code(config):
 
     for lib in LIB_DEPENDENCIES:
         cg.add_library(*lib)
+
+
+@automation.register_action(
+    "max3421e.publish_device_tree",
+    PublishDeviceTreeAction,
+    cv.Schema({
+        cv.GenerateID(): cv.use_id(MAX3421EComponent),
+    }),
+)
+async def publish_device_tree_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
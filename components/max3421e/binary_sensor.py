@@ -1,13 +1,14 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.components import binary_sensor
-from esphome.const import DEVICE_CLASS_PLUG, ENTITY_CATEGORY_DIAGNOSTIC
+from esphome.const import CONF_PORT, DEVICE_CLASS_PLUG, ENTITY_CATEGORY_DIAGNOSTIC
 
-from . import CONF_MAX3421E_ID, MAX3421EComponent
+from . import CONF_MAX3421E_ID, CONF_HUB, PORT_SCHEMA, MAX3421EComponent
 
 DEPENDENCIES = ["max3421e", "binary_sensor"]
 
 CONF_DEVICE_CONNECTED = "device_connected"
+CONF_SUSPENDED = "suspended"
 
 CONFIG_SCHEMA = cv.Schema({
     cv.GenerateID(CONF_MAX3421E_ID): cv.use_id(MAX3421EComponent),
@@ -16,7 +17,12 @@ CONFIG_SCHEMA = cv.Schema({
         entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         icon="mdi:usb-port",
     ),
-})
+    # the whole bus, independent of hub and port
+    cv.Optional(CONF_SUSPENDED): binary_sensor.binary_sensor_schema(
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:power-sleep",
+    ),
+}).extend(PORT_SCHEMA)
 
 
 async def to_code(config):
@@ -24,4 +30,11 @@ async def to_code(config):
 
     if CONF_DEVICE_CONNECTED in config:
         var = await binary_sensor.new_binary_sensor(config[CONF_DEVICE_CONNECTED])
-        cg.add(component.set_device_connected_sensor(var))
+        if CONF_PORT in config:
+            cg.add(component.add_port_connected_sensor(config[CONF_HUB], config[CONF_PORT], var))
+        else:
+            cg.add(component.set_device_connected_sensor(var))
+
+    if CONF_SUSPENDED in config:
+        var = await binary_sensor.new_binary_sensor(config[CONF_SUSPENDED])
+        cg.add(component.set_suspended_sensor(var))
@@ -1,7 +1,12 @@
 
 #include "max3421e.h"
 
+#include <algorithm>
+
+#include "esphome/core/helpers.h"
+
 #include "max3421e_pgmstrings.h"
+#include "max3421e_usb_spi.h"
 
 namespace esphome {
 namespace max3421e {
@@ -44,23 +49,60 @@ const char *state_name(uint8_t state) {
 MAX3421EComponent::MAX3421EComponent() {
   static USB Usb;
   this->usb = &Usb;
+  this->fetcher_.set_stats(&this->stats_);
+  this->fetcher_.set_cache(&this->device_cache_);
 }
 
 void MAX3421EComponent::setup() {
   ESP_LOGCONFIG(TAG, "Setting up MAX3421E...");
+  this->spi_ = this->createSpiBackend(this->spi_backend_type_);
+  if (!this->spi_->setup()) {
+    ESP_LOGE(TAG, "SPI setup failed");
+    this->mark_failed();
+    return;
+  }
+#ifdef USE_MAX3421E_IDF_SPI
+  // the USB library talks to usb_spi instead of the Arduino SPI library
+  usb_spi.set_backend(this->spi_);
+#endif
+  if (this->device_cache_.enabled()) {
+    this->device_cache_.load();
+  }
+  for (uint8_t i = 0; i < this->hubs_count_; i++) {
+    // registers itself as device class at the USB host
+    this->hubs_.push_back(new USBHub(this->usb));  // NOLINT(cppcoreguidelines-owning-memory)
+  }
   if (this->usb->Init() == -1) {
     ESP_LOGE(TAG, "USB Host Init Error");
-  } else if (this->debug_) {
-    ESP_LOGCONFIG(TAG, "  USB Host Init Success");
-    this->state_ = this->usb->getUsbTaskState();
-    ESP_LOGCONFIG(TAG, "  State: %s", state_name(state_));
+  } else {
+    if (this->spi_benchmark_) {
+      this->benchmarkSpi();
+    }
+    if (this->debug_) {
+      ESP_LOGCONFIG(TAG, "  USB Host Init Success");
+      this->state_ = this->usb->getUsbTaskState();
+      ESP_LOGCONFIG(TAG, "  State: %s", state_name(state_));
+    }
   }
+  this->last_report_ = millis();
   this->high_freq_.start();
 }
 
 void MAX3421EComponent::dump_config() {
   ESP_LOGCONFIG(TAG, "MAX3421E:");
   ESP_LOGCONFIG(TAG, "  Report Status Interval: %ds", this->report_status_interval_ / 1000);
+  ESP_LOGCONFIG(TAG, "  Hubs:                   %d", this->hubs_count_);
+  ESP_LOGCONFIG(TAG, "  Suspend Timeout:        %ums", (unsigned) this->suspend_timeout_);
+  ESP_LOGCONFIG(TAG, "    Remote Wakeup:        %s", TRUEFALSE(this->remote_wakeup_));
+  if (this->device_cache_.enabled()) {
+    ESP_LOGCONFIG(TAG, "  Device Cache:           %d devices in %s", this->device_cache_.size(),
+                  this->device_cache_.storage() == DEVICE_CACHE_STORAGE_RTC ? "rtc" : "flash");
+  }
+  ESP_LOGCONFIG(TAG, "  Device Tree Format:     %s",
+                this->device_tree_format_ == DEVICE_TREE_FORMAT_BINARY ? "binary" : "json");
+  ESP_LOGCONFIG(TAG, "  SPI Backend:            %s", spi_backend_name(this->spi_backend_type_));
+  ESP_LOGCONFIG(TAG, "    Clock Speed:          %u Hz", (unsigned) this->spi_clock_speed_);
+  ESP_LOGCONFIG(TAG, "    CS Pin:               %d", this->spi_cs_pin_);
   ESP_LOGCONFIG(TAG, "  Debug:                  %s", TRUEFALSE(this->debug_));
   ESP_LOGCONFIG(TAG, "    Verbose:              %s", TRUEFALSE(this->debug_verbose_));
 #ifdef DEBUG_USB_HOST
@@ -68,15 +110,69 @@ void MAX3421EComponent::dump_config() {
 #endif
 #ifdef USE_BINARY_SENSOR
   LOG_BINARY_SENSOR("  ", "Device Connected", this->device_connected_sensor_);
+  LOG_BINARY_SENSOR("  ", "Suspended", this->suspended_sensor_);
 #endif
 #ifdef USE_TEXT_SENSOR
   LOG_TEXT_SENSOR("  ", "Device info", this->device_info_sensor_);
+  LOG_TEXT_SENSOR("  ", "Device tree", this->device_tree_sensor_);
+#endif
+  for (auto &ps : this->port_sensors_) {
+    ESP_LOGCONFIG(TAG, "  Hub %d Port %d:", ps.hub, ps.port);
+#ifdef USE_BINARY_SENSOR
+    LOG_BINARY_SENSOR("    ", "Device Connected", ps.connected_sensor);
 #endif
+#ifdef USE_TEXT_SENSOR
+    LOG_TEXT_SENSOR("    ", "Device info", ps.info_sensor);
+#endif
+  }
 }
 
 float MAX3421EComponent::get_setup_priority() const { return setup_priority::DATA; }
 
+SPIBackend *MAX3421EComponent::createSpiBackend(SPIBackendType type) {
+  // NOLINTBEGIN(cppcoreguidelines-owning-memory)
+#ifdef USE_ESP32
+  if (type == SPI_BACKEND_ESP_IDF) {
+    return new IDFSPIBackend((spi_host_device_t) this->spi_host_, this->spi_clk_pin_, this->spi_mosi_pin_,
+                             this->spi_miso_pin_, this->spi_cs_pin_, this->spi_clock_speed_);
+  }
+#endif
+  return new ArduinoSPIBackend(this->spi_clk_pin_, this->spi_mosi_pin_, this->spi_miso_pin_, this->spi_cs_pin_,
+                               this->spi_clock_speed_);
+  // NOLINTEND(cppcoreguidelines-owning-memory)
+}
+
+void MAX3421EComponent::benchmarkSpi() {
+  spi_benchmark(this->usb, this->spi_);
+#ifdef USE_MAX3421E_IDF_SPI
+  // same accesses through the Arduino SPI library, the pins are routed to it meanwhile
+  SPIBackend *arduino = this->createSpiBackend(SPI_BACKEND_ARDUINO);
+  this->spi_->teardown();
+  if (arduino->setup()) {
+    usb_spi.set_backend(arduino);
+    spi_benchmark(this->usb, arduino);
+    arduino->teardown();
+  }
+  delete arduino;  // NOLINT(cppcoreguidelines-owning-memory)
+  if (!this->spi_->setup()) {
+    ESP_LOGE(TAG, "SPI setup failed after benchmark");
+    this->mark_failed();
+    return;
+  }
+  usb_spi.set_backend(this->spi_);
+#endif
+  // the FIFOs are filled with test data, reset the chip
+  if (this->usb->Init() == -1) {
+    ESP_LOGE(TAG, "USB Host Init Error");
+  }
+}
+
 void MAX3421EComponent::loop() {
+  if (this->bus_state_ != BUS_STATE_ACTIVE) {
+    // the USB library must not touch the bus until it is resumed
+    this->loopSuspended();
+    return;
+  }
   this->usb->Task();
   uint8_t oldState = this->state_;
   this->state_ = this->usb->getUsbTaskState();
@@ -88,11 +184,10 @@ void MAX3421EComponent::loop() {
     }
     if (this->state_ == USB_STATE_RUNNING) {
       ESP_LOGD(TAG, "device connected");
-      if (this->debug_) {
-        this->dumpDevices(this->debug_verbose_);
-      }
+      this->scanDevices();
     } else if (oldState == USB_STATE_RUNNING) {
       ESP_LOGD(TAG, "device disconnected");
+      this->clearDevices();
     }
     // update sensors
 #ifdef USE_BINARY_SENSOR
@@ -101,40 +196,257 @@ void MAX3421EComponent::loop() {
       this->device_connected_sensor_->publish_state(this->state_ == USB_STATE_RUNNING);
     }
 #endif
-#ifdef USE_TEXT_SENSOR
-    if (this->device_info_sensor_ != nullptr && (this->state_ == USB_STATE_RUNNING || oldState == USB_STATE_RUNNING)) {
-      std::string sensorText = "";
-      if (this->state_ == USB_STATE_RUNNING) {
-        UsbDevice *dev = this->getUsb()->GetAddressPool().GetUsbDevicePtr(1);
-        USB_DEVICE_DESCRIPTOR devDesc;
-        USB_DEVICE_DESCRIPTOR_STRINGS devDescStrs;
-        this->readDevDesc(dev->address.devAddress, &devDesc);
-        this->readDevDescStrs(dev->address.devAddress, &devDesc, &devDescStrs);
-        sensorText =
-            str_sprintf("%s|%s|%s", devDescStrs.iManufacturer, devDescStrs.iProduct, devDescStrs.iSerialNumber);
-      }
-      if (sensorText != this->device_info_sensor_->state) {
-        this->device_info_sensor_->publish_state(sensorText);
-      }
-    }
-#endif
+  } else if (this->state_ == USB_STATE_RUNNING) {
+    // devices behind hubs come and go while the root device keeps running
+    this->scanDevices();
+  }
+  if (this->state_ == USB_STATE_RUNNING) {
+    // interrupt endpoints have deadlines, descriptors are read with the time left
+    this->scheduler_.run(MAX3421E_SCHEDULER_BUDGET_US);
+    this->readDeviceInfos();
+    this->checkIdle();
+  }
+  if (this->device_tree_dirty_ && !this->fetcher_.busy() && !this->hasPendingDeviceInfos()) {
+    // wait until all infos are read, so the tree is published once per change
+    this->publishDeviceTree();
   }
   if (this->report_status_interval_ > 0) {
-    static uint32_t last_call = millis();
-    if (millis() - last_call > this->report_status_interval_) {
-      last_call = millis();
+    if (millis() - this->last_report_ > this->report_status_interval_) {
+      this->last_report_ = millis();
       ESP_LOGCONFIG(TAG, "---------------------------------");
       ESP_LOGCONFIG(TAG, "Usb State: %s", state_name(this->state_));
       ESP_LOGCONFIG(TAG, "---------------------------------");
       if (this->state_ == USB_STATE_RUNNING) {
-        this->dumpDevices(this->debug_verbose_);
+        this->dumpDeviceSummary();
+        this->dumpSchedule();
+        if (this->device_cache_.enabled()) {
+          ESP_LOGCONFIG(TAG, "Device cache: %d of %d devices, %u hits, %u misses", this->device_cache_.count(),
+                        this->device_cache_.size(), (unsigned) this->device_cache_.hits(),
+                        (unsigned) this->device_cache_.misses());
+        }
       }
     }
   }
 }
 
+const USB_DEVICE_ENTRY *MAX3421EComponent::getDevice(uint8_t addr) const {
+  for (auto &entry : this->devices_) {
+    if (entry.address != 0 && entry.address == addr) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+const USB_DEVICE_ENTRY *MAX3421EComponent::getPortDevice(uint8_t hub, uint8_t port) const {
+  for (auto &entry : this->devices_) {
+    if (entry.address != 0 && entry.hub == hub && entry.port == port) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+USB_PORT_SENSORS *MAX3421EComponent::getPortSensors(uint8_t hub, uint8_t port) {
+  for (auto &ps : this->port_sensors_) {
+    if (ps.hub == hub && ps.port == port) {
+      return &ps;
+    }
+  }
+  USB_PORT_SENSORS ps{};
+  ps.hub = hub;
+  ps.port = port;
+  this->port_sensors_.push_back(ps);
+  return &this->port_sensors_.back();
+}
+
+// component being scanned, the address pool only accepts a plain function as callback.
+static MAX3421EComponent *scanning = nullptr;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+void MAX3421EComponent::scanDevices() {
+  for (auto &entry : this->devices_) {
+    entry.present = false;
+  }
+  scanning = this;
+  this->usb->ForEachUsbDevice([](UsbDevice *dev) { scanning->onDeviceFound(dev); });
+  scanning = nullptr;
+  for (auto &entry : this->devices_) {
+    if (entry.address != 0 && !entry.present) {
+      this->removeDevice(&entry);
+    }
+  }
+}
+
+void MAX3421EComponent::onDeviceFound(UsbDevice *dev) {
+  uint8_t addr = dev->address.devAddress;
+  USB_DEVICE_ENTRY *slot = nullptr;
+  for (auto &entry : this->devices_) {
+    if (entry.address == addr) {
+      entry.present = true;
+      return;
+    }
+    if (entry.address == 0 && slot == nullptr) {
+      slot = &entry;
+    }
+  }
+  if (slot == nullptr) {
+    ESP_LOGW(TAG, "No free slot for device 0x%02X", addr);
+    return;
+  }
+  slot->address = addr;
+  slot->is_hub = dev->address.bmHub;
+  if (dev->address.bmParent == 0) {
+    slot->hub = 0;
+    slot->port = 0;
+  } else {
+    slot->hub = dev->address.bmParent;
+    // the address of a device behind a hub contains the port, a hub has its hub index instead
+    slot->port = slot->is_hub ? 0 : dev->address.bmAddress;
+  }
+  slot->present = true;
+  slot->info_state = DEVICE_INFO_PENDING;
+  slot->devDesc = {};
+  slot->manufacturer.clear();
+  slot->product.clear();
+  slot->serial.clear();
+  slot->conf.clear();
+  slot->attached_ms = millis();
+  slot->ready_time = 0;
+  slot->known = false;
+  ESP_LOGD(TAG, "%s 0x%02X attached to hub %d port %d", slot->is_hub ? "hub" : "device", addr, slot->hub,
+           slot->port);
+  this->publishDevice(slot, true);
+}
+
+void MAX3421EComponent::removeDevice(USB_DEVICE_ENTRY *entry) {
+  ESP_LOGD(TAG, "%s 0x%02X detached from hub %d port %d", entry->is_hub ? "hub" : "device", entry->address,
+           entry->hub, entry->port);
+  if (this->fetcher_.address() == entry->address) {
+    this->fetcher_.reset();
+  }
+  this->publishDevice(entry, false);
+  this->stats_.forget(entry->address);
+  this->scheduler_.remove_device(entry->address);
+  entry->address = 0;
+}
+
+void MAX3421EComponent::clearDevices() {
+  for (auto &entry : this->devices_) {
+    if (entry.address != 0) {
+      this->removeDevice(&entry);
+    }
+  }
+  this->fetcher_.reset();
+}
+
+bool MAX3421EComponent::hasPendingDeviceInfos() const {
+  for (auto &entry : this->devices_) {
+    if (entry.address != 0 && entry.info_state == DEVICE_INFO_PENDING) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void MAX3421EComponent::readDeviceInfos() {
+  if (!this->fetcher_.busy()) {
+    for (auto &entry : this->devices_) {
+      if (entry.address != 0 && entry.info_state == DEVICE_INFO_PENDING) {
+        entry.info_state = DEVICE_INFO_READING;
+        this->fetcher_.start(entry.address);
+        break;
+      }
+    }
+    if (!this->fetcher_.busy()) {
+      return;
+    }
+  }
+  // read at most one descriptor per loop, so a slow device doesn't block other components
+  if (!this->fetcher_.step(this->usb)) {
+    return;
+  }
+  const DescriptorFetcher &fetcher = this->fetcher_;
+  if (this->debug_) {
+    ESP_LOGD(TAG,
+             "Device info of 0x%02X %s in %ums (transfers: %uus, %s: %uus, %s: %uus, %s: %uus, %s: %uus, %s: %uus, "
+             "%s: %uus)",
+             fetcher.address(), fetcher.done() ? "read" : "failed", fetcher.elapsed_time(), fetcher.transfer_time(),
+             desc_fetch_stage_name(DESC_FETCH_DEVICE), fetcher.stage_time(DESC_FETCH_DEVICE),
+             desc_fetch_stage_name(DESC_FETCH_LANGID), fetcher.stage_time(DESC_FETCH_LANGID),
+             desc_fetch_stage_name(DESC_FETCH_MANUFACTURER), fetcher.stage_time(DESC_FETCH_MANUFACTURER),
+             desc_fetch_stage_name(DESC_FETCH_PRODUCT), fetcher.stage_time(DESC_FETCH_PRODUCT),
+             desc_fetch_stage_name(DESC_FETCH_SERIAL), fetcher.stage_time(DESC_FETCH_SERIAL),
+             desc_fetch_stage_name(DESC_FETCH_CONFIG), fetcher.stage_time(DESC_FETCH_CONFIG));
+  }
+  for (auto &entry : this->devices_) {
+    if (entry.address == fetcher.address() && entry.info_state == DEVICE_INFO_READING) {
+      // on failure keep what was read so far, like the blocking read did
+      entry.info_state = fetcher.done() ? DEVICE_INFO_READ : DEVICE_INFO_FAILED;
+      entry.devDesc = fetcher.dev_desc();
+      entry.manufacturer = fetcher.dev_desc_strs().iManufacturer;
+      entry.product = fetcher.dev_desc_strs().iProduct;
+      entry.serial = fetcher.dev_desc_strs().iSerialNumber;
+      entry.conf.swap(this->fetcher_.conf_summary());
+      if (fetcher.done()) {
+        entry.known = fetcher.cached();
+        entry.ready_time = std::max<uint32_t>(millis() - entry.attached_ms, 1);
+        this->ready_time_[entry.known ? 1 : 0] = entry.ready_time;
+        ESP_LOGD(TAG, "%s device 0x%02X %04X:%04X ready in %ums", entry.known ? "Known" : "New", entry.address,
+                 entry.devDesc.idVendor, entry.devDesc.idProduct, (unsigned) entry.ready_time);
+        // a truncated summary would be restored as the whole configuration
+        if (!entry.known && this->device_cache_.enabled() && !fetcher.conf_truncated()) {
+          this->device_cache_.store(entry.devDesc, entry.serial.c_str(), entry.manufacturer.c_str(),
+                                    entry.product.c_str(), entry.conf);
+        }
+      }
+      if (this->debug_) {
+        // dumped once its infos are read, devices are listed as they become ready
+        this->dumpDevice(&entry, this->debug_verbose_);
+      }
+      this->publishDevice(&entry, true);
+      break;
+    }
+  }
+  this->fetcher_.reset();
+}
+
+void MAX3421EComponent::publishDevice(const USB_DEVICE_ENTRY *entry, bool connected) {
+  this->device_tree_dirty_ = true;
+  if (entry->is_hub && entry->hub != 0) {
+    // the port of a hub behind another hub is unknown
+    return;
+  }
+#ifdef USE_TEXT_SENSOR
+  std::string info = "";
+  if (connected && entry->info_state >= DEVICE_INFO_READ) {
+    info = str_sprintf("%s|%s|%s", entry->manufacturer.c_str(), entry->product.c_str(), entry->serial.c_str());
+  }
+  if (entry->hub == 0 && this->device_info_sensor_ != nullptr && info != this->device_info_sensor_->state) {
+    this->device_info_sensor_->publish_state(info);
+  }
+#endif
+  for (auto &ps : this->port_sensors_) {
+    if (ps.hub != entry->hub || ps.port != entry->port) {
+      continue;
+    }
+#ifdef USE_BINARY_SENSOR
+    if (ps.connected_sensor != nullptr &&
+        (!ps.connected_sensor->has_state() || ps.connected_sensor->state != connected)) {
+      ps.connected_sensor->publish_state(connected);
+    }
+#endif
+#ifdef USE_TEXT_SENSOR
+    if (ps.info_sensor != nullptr && info != ps.info_sensor->state) {
+      ps.info_sensor->publish_state(info);
+    }
+#endif
+  }
+}
+
 uint8_t MAX3421EComponent::readDevDesc(uint8_t addr, USB_DEVICE_DESCRIPTOR *devDesc) {
+  uint32_t start = micros();
   uint8_t rcode = this->usb->getDevDescr(addr, 0, DEV_DESCR_LEN, (uint8_t *) devDesc);
+  this->stats_.record_since(addr, STATS_CONTROL_ENDPOINT, rcode, rcode ? 0 : DEV_DESCR_LEN, start);
   if (rcode) {
     ESP_LOGE(TAG, DevDescError, rcode);
   }
@@ -162,38 +474,47 @@ uint8_t MAX3421EComponent::readDevDescStr(uint8_t addr, uint8_t idx, char *devDe
   uint8_t rcode = 0;
   uint8_t buf[MAX3421E_MAX_DESCRIPTOR_LEN];
   uint8_t length;
+  uint32_t start;
   devDescStr[0] = '\0';
 
+  start = micros();
   rcode = this->usb->getStrDescr(addr, 0, 1, 0, 0, buf);  // get language table length
+  this->stats_.record_since(addr, STATS_CONTROL_ENDPOINT, rcode, rcode ? 0 : 1, start);
   if (rcode) {
     ESP_LOGE(TAG, DevDescStrErrFormat, DevDescStrErrTableLength, 0, rcode);
     return rcode;
   }
   length = buf[0];                                             // length is the first byte
+  start = micros();
   rcode = this->usb->getStrDescr(addr, 0, length, 0, 0, buf);  // get language table
+  this->stats_.record_since(addr, STATS_CONTROL_ENDPOINT, rcode, rcode ? 0 : length, start);
   if (rcode) {
     ESP_LOGE(TAG, DevDescStrErrFormat, DevDescStrErrTable, 0, rcode);
     return rcode;
   }
   uint16_t langid = (buf[3] << 8) | buf[2];
+  start = micros();
   rcode = this->usb->getStrDescr(addr, 0, 1, idx, langid, buf);
+  this->stats_.record_since(addr, STATS_CONTROL_ENDPOINT, rcode, rcode ? 0 : 1, start);
   if (rcode) {
     ESP_LOGE(TAG, DevDescStrErrFormat, DevDescStrErrStringLength, idx, rcode);
     return rcode;
   }
   length = buf[0];
+  start = micros();
   rcode = this->usb->getStrDescr(addr, 0, length, idx, langid, buf);
+  this->stats_.record_since(addr, STATS_CONTROL_ENDPOINT, rcode, rcode ? 0 : length, start);
   if (rcode) {
     ESP_LOGE(TAG, DevDescStrErrFormat, DevDescStrErrString, idx, rcode);
     return rcode;
   }
 
-  uint8_t i;
-  for (i = 2; i < length; i += 2) {  // string is UTF-16LE encoded
-    // str += (char) buf[i];
-    devDescStr[(i - 2) / 2] = buf[i];
+  // a 255 byte descriptor ends with half a character, which is dropped
+  size_t chars = 0;
+  for (size_t i = 2; i + 1 < length && chars < MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN; i += 2) {
+    devDescStr[chars++] = buf[i];  // string is UTF-16LE encoded
   }
-  devDescStr[(i - 2) / 2] = '\0';
+  devDescStr[chars] = '\0';
   return rcode;
 }
 
@@ -247,128 +568,264 @@ void MAX3421EComponent::dumpDevDescStrs(USB_DEVICE_DESCRIPTOR_STRINGS *devDescSt
 }
 
 void MAX3421EComponent::dumpDevFullConfDesc(uint8_t addr, uint8_t conf) {
-  uint8_t buf[MAX3421E_MAX_CONFIG_DESCRIPTOR_LEN];
-  uint8_t *buf_ptr = buf;
-
-  uint8_t rcode = this->usb->getConfDescr(addr, 0, 4, conf, buf);  // get configuration descriptor itself
+  // streamed in endpoint sized chunks, so the descriptor is never truncated and needs no big buffer
+  ConfDescParser parser([this](const uint8_t *desc, uint8_t len) { this->dumpDescriptor(desc, len); });
+  uint32_t start = micros();
+  uint8_t rcode = this->usb->getConfDescr(addr, 0, conf, &parser);
+  this->stats_.record_since(addr, STATS_CONTROL_ENDPOINT, rcode, parser.received(), start);
   if (rcode) {
     ESP_LOGE(TAG, DevConfDescError, rcode);
     return;
   }
-  uint16_t length;
-  LOBYTE(length) = buf[2];
-  HIBYTE(length) = buf[3];
-  if (length > MAX3421E_MAX_CONFIG_DESCRIPTOR_LEN) {  // check if total length is larger than buffer
-    ESP_LOGW(TAG, DeviceConfDescLengthWarning, length, MAX3421E_MAX_CONFIG_DESCRIPTOR_LEN);
-    length = MAX3421E_MAX_CONFIG_DESCRIPTOR_LEN;
+  if (parser.error() || parser.incomplete()) {
+    ESP_LOGW(TAG, DevConfDescMalformedWarning, (unsigned) parser.received());
   }
-  rcode = this->usb->getConfDescr(addr, 0, length, conf, buf);  // get the whole descriptor
-  if (rcode) {
-    ESP_LOGE(TAG, DevConfDescError, rcode);
+}
+
+void MAX3421EComponent::dumpDescriptor(const uint8_t *desc, uint8_t desc_len) {
+  // descriptors too short for their struct are dumped like unknown ones instead of reading past them
+  DescriptorView view(desc, desc_len);
+  if (const auto *cd = view.as<USB_CONFIGURATION_DESCRIPTOR>()) {
+    ESP_LOGCONFIG(TAG, DevConfDescHeader);
+    ESP_LOGCONFIG(TAG, DevConfDescTotlenFormat, cd->wTotalLength);
+    ESP_LOGCONFIG(TAG, DevConfDescNintFormat, cd->bNumInterfaces);
+    ESP_LOGCONFIG(TAG, DevConfDescValueFormat, cd->bConfigurationValue);
+    ESP_LOGCONFIG(TAG, DevConfDescStringFormat, cd->iConfiguration);
+    ESP_LOGCONFIG(TAG, DevConfDescAttrFormat, cd->bmAttributes);
+    ESP_LOGCONFIG(TAG, DevConfDescPwrFormat, cd->bMaxPower);
+  } else if (const auto *id = view.as<USB_INTERFACE_DESCRIPTOR>()) {
+    ESP_LOGCONFIG(TAG, DevConfIntfDescHeader);
+    ESP_LOGCONFIG(TAG, DevConfIntfDescNumberFormat, id->bInterfaceNumber);
+    ESP_LOGCONFIG(TAG, DevConfIntfDescAltFormat, id->bAlternateSetting);
+    ESP_LOGCONFIG(TAG, DevConfIntfDescEndpointsFormat, id->bNumEndpoints);
+    ESP_LOGCONFIG(TAG, DevConfIntfDescClassFormat, id->bInterfaceClass);
+    ESP_LOGCONFIG(TAG, DevConfIntfDescSubclassFormat, id->bInterfaceSubClass);
+    ESP_LOGCONFIG(TAG, DevConfIntfDescProtocolFormat, id->bInterfaceProtocol);
+    ESP_LOGCONFIG(TAG, DevConfIntfDescStringFormat, id->iInterface);
+  } else if (const auto *ed = view.as<USB_ENDPOINT_DESCRIPTOR>()) {
+    ESP_LOGCONFIG(TAG, DevConfEpDescHeaderFormat);
+    ESP_LOGCONFIG(TAG, DevConfEpDescAddressFormat, ed->bEndpointAddress);
+    ESP_LOGCONFIG(TAG, DevConfEpDescAttrFormat, ed->bmAttributes);
+    ESP_LOGCONFIG(TAG, DevConfEpDescPktsizeFormat, ed->wMaxPacketSize);
+    ESP_LOGCONFIG(TAG, DevConfEpDescIntervalFormat, ed->bInterval);
+  } else if (const auto *hd = view.as<HubDescriptor>()) {
+    ESP_LOGCONFIG(TAG, DevConfHubDescHeaderFormat);
+    ESP_LOGCONFIG(TAG, DevConfHubDescDescLengthFormat, hd->bDescLength);
+    ESP_LOGCONFIG(TAG, DevConfHubDescDescTypeFormat, hd->bDescriptorType);
+    ESP_LOGCONFIG(TAG, DevConfHubDescNbrPortsFormat, hd->bNbrPorts);
+    ESP_LOGCONFIG(TAG, DevConfHubDescLogPwrSwitchModeFormat, hd->LogPwrSwitchMode);
+    ESP_LOGCONFIG(TAG, DevConfHubDescCompoundDeviceFormat, hd->CompoundDevice);
+    ESP_LOGCONFIG(TAG, DevConfHubDescOverCurrentProtectModeFormat, hd->OverCurrentProtectMode);
+    ESP_LOGCONFIG(TAG, DevConfHubDescTTThinkTimeFormat, hd->TTThinkTime);
+    ESP_LOGCONFIG(TAG, DevConfHubDescPortIndicatorsSupportedFormat, hd->PortIndicatorsSupported);
+    ESP_LOGCONFIG(TAG, DevConfHubDescReservedFormat, hd->Reserved);
+    ESP_LOGCONFIG(TAG, DevConfHubDescbPwrOn2PwrGoodFormat, hd->bPwrOn2PwrGood);
+    ESP_LOGCONFIG(TAG, DevConfHubDescbHubContrCurrentFormat, hd->bHubContrCurrent);
+    if (desc_len > sizeof(HubDescriptor)) {
+      ESP_LOGCONFIG(TAG, "%s", format_hex(desc + sizeof(HubDescriptor), desc_len - sizeof(HubDescriptor)).c_str());
+    }
+  } else {
+    ESP_LOGCONFIG(TAG, DevConfUnkDescHeaderFormat);
+    ESP_LOGCONFIG(TAG, DevConfUnkDescLengthFormat, desc_len);
+    ESP_LOGCONFIG(TAG, DevConfUnkDescTypeFormat, desc[1]);
+    if (desc_len > 2) {
+      ESP_LOGCONFIG(TAG, DevConfUnkDescContentsFormat, format_hex(desc + 2, desc_len - 2).c_str());
+    } else {
+      ESP_LOGCONFIG(TAG, DevConfUnkDescContentsFormat, DeviceNoData);
+    }
+  }
+}
+
+void MAX3421EComponent::dumpDeviceSummary() {
+  for (auto &entry : this->devices_) {
+    if (entry.address == 0) {
+      continue;
+    }
+    if (entry.info_state < DEVICE_INFO_READ) {
+      ESP_LOGCONFIG(TAG, "Addr: %x (Hub: %d, Port: %d) reading infos", entry.address, entry.hub, entry.port);
+      continue;
+    }
+    ESP_LOGCONFIG(TAG, "Addr: %x (Hub: %d, Port: %d) %04X:%04X %s|%s|%s ready in %ums%s", entry.address, entry.hub,
+                  entry.port, entry.devDesc.idVendor, entry.devDesc.idProduct, entry.manufacturer.c_str(),
+                  entry.product.c_str(), entry.serial.c_str(), (unsigned) entry.ready_time,
+                  entry.known ? " (known)" : "");
+  }
+}
+
+void MAX3421EComponent::checkIdle() {
+  uint32_t bytes = this->stats_.total().bytes;
+  if (bytes != this->idle_bytes_ || this->fetcher_.busy() || this->hasPendingDeviceInfos()) {
+    this->idle_bytes_ = bytes;
+    this->idle_since_ = millis();
     return;
   }
+  if (this->suspend_timeout_ > 0 && millis() - this->idle_since_ >= this->suspend_timeout_) {
+    this->suspendBus();
+  }
+}
 
-  uint8_t desc_len;
-  uint8_t desc_type;
-  while (buf_ptr < buf + length) {  // parsing descriptors
-    desc_len = *(buf_ptr);
-    desc_type = *(buf_ptr + 1);
-
-    switch (desc_type) {
-      case (USB_DESCRIPTOR_CONFIGURATION):
-        ESP_LOGCONFIG(TAG, DevConfDescHeader);
-        ESP_LOGCONFIG(TAG, DevConfDescTotlenFormat, ((USB_CONFIGURATION_DESCRIPTOR *) buf_ptr)->wTotalLength);
-        ESP_LOGCONFIG(TAG, DevConfDescNintFormat, ((USB_CONFIGURATION_DESCRIPTOR *) buf_ptr)->bNumInterfaces);
-        ESP_LOGCONFIG(TAG, DevConfDescValueFormat, ((USB_CONFIGURATION_DESCRIPTOR *) buf_ptr)->bConfigurationValue);
-        ESP_LOGCONFIG(TAG, DevConfDescStringFormat, ((USB_CONFIGURATION_DESCRIPTOR *) buf_ptr)->iConfiguration);
-        ESP_LOGCONFIG(TAG, DevConfDescAttrFormat, ((USB_CONFIGURATION_DESCRIPTOR *) buf_ptr)->bmAttributes);
-        ESP_LOGCONFIG(TAG, DevConfDescPwrFormat, ((USB_CONFIGURATION_DESCRIPTOR *) buf_ptr)->bMaxPower);
-        break;
-      case (USB_DESCRIPTOR_INTERFACE):
-        ESP_LOGCONFIG(TAG, DevConfIntfDescHeader);
-        ESP_LOGCONFIG(TAG, DevConfIntfDescNumberFormat, ((USB_INTERFACE_DESCRIPTOR *) buf_ptr)->bInterfaceNumber);
-        ESP_LOGCONFIG(TAG, DevConfIntfDescAltFormat, ((USB_INTERFACE_DESCRIPTOR *) buf_ptr)->bAlternateSetting);
-        ESP_LOGCONFIG(TAG, DevConfIntfDescEndpointsFormat, ((USB_INTERFACE_DESCRIPTOR *) buf_ptr)->bNumEndpoints);
-        ESP_LOGCONFIG(TAG, DevConfIntfDescClassFormat, ((USB_INTERFACE_DESCRIPTOR *) buf_ptr)->bInterfaceClass);
-        ESP_LOGCONFIG(TAG, DevConfIntfDescSubclassFormat, ((USB_INTERFACE_DESCRIPTOR *) buf_ptr)->bInterfaceSubClass);
-        ESP_LOGCONFIG(TAG, DevConfIntfDescProtocolFormat, ((USB_INTERFACE_DESCRIPTOR *) buf_ptr)->bInterfaceProtocol);
-        ESP_LOGCONFIG(TAG, DevConfIntfDescStringFormat, ((USB_INTERFACE_DESCRIPTOR *) buf_ptr)->iInterface);
-        break;
-      case (USB_DESCRIPTOR_ENDPOINT):
-        ESP_LOGCONFIG(TAG, DevConfEpDescHeaderFormat);
-        ESP_LOGCONFIG(TAG, DevConfEpDescAddressFormat, ((USB_ENDPOINT_DESCRIPTOR *) buf_ptr)->bEndpointAddress);
-        ESP_LOGCONFIG(TAG, DevConfEpDescAttrFormat, ((USB_ENDPOINT_DESCRIPTOR *) buf_ptr)->bmAttributes);
-        ESP_LOGCONFIG(TAG, DevConfEpDescPktsizeFormat, ((USB_ENDPOINT_DESCRIPTOR *) buf_ptr)->wMaxPacketSize);
-        ESP_LOGCONFIG(TAG, DevConfEpDescIntervalFormat, ((USB_ENDPOINT_DESCRIPTOR *) buf_ptr)->bInterval);
-        break;
-      case 0x29: {
-        ESP_LOGCONFIG(TAG, DevConfHubDescHeaderFormat);
-        ESP_LOGCONFIG(TAG, DevConfHubDescDescLengthFormat, ((HubDescriptor *) buf_ptr)->bDescLength);
-        ESP_LOGCONFIG(TAG, DevConfHubDescDescTypeFormat, ((HubDescriptor *) buf_ptr)->bDescriptorType);
-        ESP_LOGCONFIG(TAG, DevConfHubDescNbrPortsFormat, ((HubDescriptor *) buf_ptr)->bNbrPorts);
-        ESP_LOGCONFIG(TAG, DevConfHubDescLogPwrSwitchModeFormat, ((HubDescriptor *) buf_ptr)->LogPwrSwitchMode);
-        ESP_LOGCONFIG(TAG, DevConfHubDescCompoundDeviceFormat, ((HubDescriptor *) buf_ptr)->CompoundDevice);
-        ESP_LOGCONFIG(TAG, DevConfHubDescOverCurrentProtectModeFormat,
-                      ((HubDescriptor *) buf_ptr)->OverCurrentProtectMode);
-        ESP_LOGCONFIG(TAG, DevConfHubDescTTThinkTimeFormat, ((HubDescriptor *) buf_ptr)->TTThinkTime);
-        ESP_LOGCONFIG(TAG, DevConfHubDescPortIndicatorsSupportedFormat,
-                      ((HubDescriptor *) buf_ptr)->PortIndicatorsSupported);
-        ESP_LOGCONFIG(TAG, DevConfHubDescReservedFormat, ((HubDescriptor *) buf_ptr)->Reserved);
-        ESP_LOGCONFIG(TAG, DevConfHubDescbPwrOn2PwrGoodFormat, ((HubDescriptor *) buf_ptr)->bPwrOn2PwrGood);
-        ESP_LOGCONFIG(TAG, DevConfHubDescbHubContrCurrentFormat, ((HubDescriptor *) buf_ptr)->bHubContrCurrent);
-        char b[(desc_len - 7 - 1) * 2];
-        char *bp = b;
-        for (int i = 7; i < desc_len; i++) {
-          sprintf(bp, "%02x", buf_ptr[i]);
-          bp += 2;
-        }
-        ESP_LOGCONFIG(TAG, "%s", b);
-        break;
+void MAX3421EComponent::suspendBus() {
+  if (this->remote_wakeup_) {
+    this->enableRemoteWakeup();
+  }
+  ESP_LOGD(TAG, "Suspending bus after %ums without traffic", (unsigned) (millis() - this->idle_since_));
+  uint8_t mode = this->usb->regRd(rMODE);
+  SPI_REG_WRITE writes[] = {
+      {rHIRQ, bmRWUIRQ | bmBUSEVENTIRQ},  // forget old events
+      {rMODE, (uint8_t) (mode & ~bmSOFKAENAB)},
+  };
+  this->spi_->write_registers(writes, 2);
+  this->setBusState(BUS_STATE_SUSPENDED);
+}
+
+void MAX3421EComponent::requestResume() {
+  if (this->bus_state_ != BUS_STATE_SUSPENDED) {
+    return;
+  }
+  SPI_REG_WRITE writes[] = {
+      {rHIRQ, bmBUSEVENTIRQ},
+      {rHCTL, bmSIGRSM},
+  };
+  this->spi_->write_registers(writes, 2);
+  this->setBusState(BUS_STATE_RESUMING);
+}
+
+void MAX3421EComponent::loopSuspended() {
+  uint32_t elapsed = millis() - this->bus_state_since_;
+  switch (this->bus_state_) {
+    case BUS_STATE_SUSPENDED: {
+      uint8_t hirq = this->usb->regRd(rHIRQ);
+      if (hirq & bmCONDETIRQ) {
+        // attach or detach, leave it to the USB library. Devices still attached, e.g. behind a hub, need the SOFs
+        // before they suspend again.
+        ESP_LOGD(TAG, "Connection changed while suspended");
+        this->usb->regWr(rMODE, this->usb->regRd(rMODE) | bmSOFKAENAB);
+        this->setBusState(BUS_STATE_ACTIVE);
+      } else if (hirq & bmRWUIRQ) {
+        ESP_LOGD(TAG, "Remote wakeup");
+        this->usb->regWr(rHIRQ, bmRWUIRQ);
+        this->requestResume();
       }
-      default: {
-        uint8_t i;
-        ESP_LOGCONFIG(TAG, DevConfUnkDescHeaderFormat);
-        ESP_LOGCONFIG(TAG, DevConfUnkDescLengthFormat, desc_len);
-        ESP_LOGCONFIG(TAG, DevConfUnkDescTypeFormat, *(buf_ptr + 1));
-        buf_ptr += 2;
-        if (desc_len > 0) {
-          char b[desc_len * 2];
-          char *buf_ptr = b;
-          for (i = 0; i < desc_len; i++) {
-            sprintf(buf_ptr, "%02x", *buf_ptr);
-            buf_ptr += 2;
-            buf_ptr++;
-          }
-          ESP_LOGCONFIG(TAG, DevConfUnkDescContentsFormat, b);
-        } else {
-          ESP_LOGCONFIG(TAG, DevConfUnkDescContentsFormat, DeviceNoData);
-        }
-        break;
+      break;
+    }
+    case BUS_STATE_RESUMING:
+      // SOFs have to start within 3ms after the resume signal ended, before the devices suspend again
+      if ((this->usb->regRd(rHIRQ) & bmBUSEVENTIRQ) || elapsed >= MAX3421E_RESUME_TIMEOUT_MS) {
+        SPI_REG_WRITE writes[] = {
+            {rHIRQ, bmBUSEVENTIRQ},
+            {rMODE, (uint8_t) (this->usb->regRd(rMODE) | bmSOFKAENAB)},
+        };
+        this->spi_->write_registers(writes, 2);
+        this->setBusState(BUS_STATE_RECOVERING);
       }
+      break;
+    case BUS_STATE_RECOVERING:
+      if (elapsed >= MAX3421E_RESUME_RECOVERY_MS) {
+        this->setBusState(BUS_STATE_ACTIVE);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void MAX3421EComponent::enableRemoteWakeup() {
+  for (auto &entry : this->devices_) {
+    if (entry.address == 0) {
+      continue;
     }
-    buf_ptr = (buf_ptr + desc_len);
-  }
-}
-
-// TODO: getting error in printDevDescr when connecting a hub after a device was connected the first time
-void MAX3421EComponent::dumpDevices(bool verbose) {
-  for (uint8_t i = 1; i < USB_NUMDEVICES; i++) {
-    UsbDevice *dev = this->usb->GetAddressPool().GetUsbDevicePtr(i);
-    if (dev != NULL) {
-      ESP_LOGCONFIG(TAG, "Addr: %x (Hub: %x, Prnt: %x, Dev: %x)", dev->address.devAddress, dev->address.bmHub,
-                    dev->address.bmParent, dev->address.bmAddress);
-      USB_DEVICE_DESCRIPTOR devDesc;
-      USB_DEVICE_DESCRIPTOR_STRINGS devDescStrs;
-      this->readDevDesc(dev->address.devAddress, &devDesc);
-      this->readDevDescStrs(dev->address.devAddress, &devDesc, &devDescStrs);
-      ESP_LOGCONFIG(TAG, DevDescHeader);
-      this->dumpDevDescStrs(&devDescStrs);
-      if (verbose) {
-        this->dumpDevDesc(&devDesc);
-        for (uint8_t i = 0; i < devDesc.bNumConfigurations; i++) {
-          this->dumpDevFullConfDesc(dev->address.devAddress, i);
-        }
+    auto *conf = DescriptorRange(entry.conf).first<USB_CONFIGURATION_DESCRIPTOR>();
+    if (conf == nullptr || !(conf->bmAttributes & 0x20)) {  // remote wakeup
+      continue;
+    }
+    uint32_t start = micros();
+    uint8_t rcode = this->usb->ctrlReq(entry.address, 0, bmREQ_SET, USB_REQUEST_SET_FEATURE,
+                                       USB_FEATURE_DEVICE_REMOTE_WAKEUP, 0x00, 0x0000, 0x0000, 0x0000, nullptr,
+                                       nullptr);
+    this->stats_.record_since(entry.address, STATS_CONTROL_ENDPOINT, rcode, 0, start);
+    if (rcode) {
+      ESP_LOGW(TAG, "Enabling remote wakeup of device 0x%02X failed. Error code: 0x%02X", entry.address, rcode);
+    }
+  }
+}
+
+void MAX3421EComponent::setBusState(BusState state) {
+  uint32_t now = millis();
+  if (this->bus_state_ == BUS_STATE_SUSPENDED) {
+    this->suspended_time_ += now - this->bus_state_since_;
+  }
+  bool was_suspended = this->isSuspended();
+  BusState old_state = this->bus_state_;
+  this->bus_state_ = state;
+  this->bus_state_since_ = now;
+  if (state == BUS_STATE_SUSPENDED) {
+    // nothing to do in a hurry until a resume is requested
+    this->high_freq_.stop();
+  } else if (old_state == BUS_STATE_SUSPENDED) {
+    // the end of the resume signal is polled, it has to be noticed within a few milliseconds
+    this->high_freq_.start();
+  }
+  if (this->isSuspended() == was_suspended) {
+    return;
+  }
+  if (was_suspended) {
+    // the resume doesn't count as traffic, the timeout starts over
+    this->idle_bytes_ = this->stats_.total().bytes;
+    this->idle_since_ = now;
+  }
+#ifdef USE_BINARY_SENSOR
+  if (this->suspended_sensor_ != nullptr) {
+    this->suspended_sensor_->publish_state(this->isSuspended());
+  }
+#endif
+}
+
+uint32_t MAX3421EComponent::getSuspendedTime() const {
+  uint32_t time = this->suspended_time_;
+  if (this->bus_state_ == BUS_STATE_SUSPENDED) {
+    time += millis() - this->bus_state_since_;
+  }
+  return time;
+}
+
+void MAX3421EComponent::dumpSchedule() {
+  for (auto &ep : this->scheduler_.endpoints()) {
+    ESP_LOGCONFIG(TAG,
+                  "Addr: %x EP: %02X every %dms, polls: %u, NAKs: %u, errors: %u, missed: %u (max %ums late), "
+                  "skipped: %u",
+                  ep.address, ep.endpoint, ep.interval * ep.backoff, (unsigned) ep.polls, (unsigned) ep.naks,
+                  (unsigned) ep.errors, (unsigned) ep.misses, (unsigned) ep.max_late, (unsigned) ep.skipped);
+  }
+}
+
+void MAX3421EComponent::dumpDevice(const USB_DEVICE_ENTRY *entry, bool verbose) {
+  UsbDeviceAddress address;
+  address.devAddress = entry->address;
+  ESP_LOGCONFIG(TAG, "Addr: %x (Hub: %x, Prnt: %x, Dev: %x)", address.devAddress, address.bmHub, address.bmParent,
+                address.bmAddress);
+  // only the infos read in the background, asking the device again would block the loop
+  USB_DEVICE_DESCRIPTOR devDesc = entry->devDesc;
+  USB_DEVICE_DESCRIPTOR_STRINGS devDescStrs;
+  snprintf(devDescStrs.iManufacturer, sizeof(devDescStrs.iManufacturer), "%s", entry->manufacturer.c_str());
+  snprintf(devDescStrs.iProduct, sizeof(devDescStrs.iProduct), "%s", entry->product.c_str());
+  snprintf(devDescStrs.iSerialNumber, sizeof(devDescStrs.iSerialNumber), "%s", entry->serial.c_str());
+  ESP_LOGCONFIG(TAG, DevDescHeader);
+  this->dumpDevDescStrs(&devDescStrs);
+  if (verbose) {
+    this->dumpDevDesc(&devDesc);
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERY_VERBOSE
+    // the whole configurations including class specific descriptors, read again from the device.
+    // This blocks the loop for the transfers, which is accepted at this log level.
+    if (entry->info_state == DEVICE_INFO_READ) {
+      for (uint8_t conf = 0; conf < devDesc.bNumConfigurations; conf++) {
+        this->dumpDevFullConfDesc(entry->address, conf);
       }
+      return;
+    }
+#endif
+    // configuration, interface and endpoint descriptors of the configuration summary
+    for (const DescriptorView &desc : DescriptorRange(entry->conf)) {
+      this->dumpDescriptor(desc.data(), desc.length());
     }
   }
 }
@@ -1,35 +1,103 @@
 #pragma once
 
 #include "esphome/core/defines.h"
+#include "esphome/core/automation.h"
 #include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
 #include "esphome/core/log.h"
 
+#include <vector>
+
 #include "esphome/components/binary_sensor/binary_sensor.h"
 #include "esphome/components/text_sensor/text_sensor.h"
 
 #include "Usb.h"
 #include "usbhub.h"
 
-#define MAX3421E_MAX_DESCRIPTOR_LEN 0xFF
-// (MAX3421E_MAX_DESCRIPTOR_LEN - 1 (bLength byte) - 1 (bDescriptorType byte)) / 2 (2 bytes per UTF-16-LE char)
-#define MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN 126
-#ifndef MAX3421E_MAX_CONFIG_DESCRIPTOR_LEN
-// can be up to 0xFFFF. By default it will be truncated to this setting to save memory.
-#define MAX3421E_MAX_CONFIG_DESCRIPTOR_LEN 0xFF
-#endif
+#include "max3421e_descriptors.h"
+#include "max3421e_device_cache.h"
+#include "max3421e_fetcher.h"
+#include "max3421e_parser.h"
+#include "max3421e_scheduler.h"
+#include "max3421e_spi.h"
+#include "max3421e_stats.h"
 
 namespace esphome {
 namespace max3421e {
 
 static const char *const TAG = "max3421e";
 
+const char *state_name(uint8_t state);
+
+enum DeviceInfoState : uint8_t {
+  DEVICE_INFO_PENDING = 0,
+  DEVICE_INFO_READING,
+  DEVICE_INFO_READ,
+  DEVICE_INFO_FAILED,
+};
+
+// a device found in the address pool of the USB host.
 typedef struct {
-  char iManufacturer[MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN + 1];  // +1 for '/0'
-  char iProduct[MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN + 1];       // +1 for '/0'
-  char iSerialNumber[MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN + 1];  // +1 for '/0'
-} USB_DEVICE_DESCRIPTOR_STRINGS;
+  uint8_t address;  // 0 marks a free slot
+  uint8_t hub;      // index of the hub the device is attached to, 0 for the root port
+  uint8_t port;     // port on the hub, 0 for the root port or if unknown (hubs behind hubs)
+  bool is_hub;
+  bool present;  // used to detect detached devices while scanning the address pool
+  DeviceInfoState info_state;
+  USB_DEVICE_DESCRIPTOR devDesc;
+  std::string manufacturer;
+  std::string product;
+  std::string serial;
+  // configuration, interface and endpoint descriptors of all configurations
+  std::vector<uint8_t> conf;
+  uint32_t attached_ms;  // millis() when the device was found in the address pool
+  uint32_t ready_time;   // ms from being found until its infos were read, 0 until then
+  bool known;            // infos were taken from the device cache
+} USB_DEVICE_ENTRY;
 
-const char *state_name(uint8_t state);
+enum DeviceTreeFormat : uint8_t {
+  DEVICE_TREE_FORMAT_JSON = 0,
+  // base64 encoded, decode with tools/decode_device_tree.py
+  DEVICE_TREE_FORMAT_BINARY,
+};
+
+enum BusState : uint8_t {
+  BUS_STATE_ACTIVE = 0,
+  // SOFs stopped, the devices suspend themselves after 3ms of idle bus
+  BUS_STATE_SUSPENDED,
+  // resume signaling (K state) for 20ms
+  BUS_STATE_RESUMING,
+  // SOFs running again, devices get 10ms to recover before transfers
+  BUS_STATE_RECOVERING,
+};
+
+#ifndef MAX3421E_RESUME_TIMEOUT_MS
+// resume signaling takes 20ms, give up waiting for its end after this time.
+#define MAX3421E_RESUME_TIMEOUT_MS 30
+#endif
+// resume recovery time the devices get before the first transfer.
+#define MAX3421E_RESUME_RECOVERY_MS 10
+
+// version of the binary device tree format
+static const uint8_t DEVICE_TREE_BINARY_VERSION = 1;
+// Home Assistant rejects longer states, the device tree sensor only gets a summary of the tree.
+#define MAX3421E_DEVICE_TREE_STATE_LEN 255
+#ifndef MAX3421E_DEVICE_TREE_LOG_CHUNK
+// characters of the device tree per log line, the logger truncates longer lines.
+#define MAX3421E_DEVICE_TREE_LOG_CHUNK 384
+#endif
+
+// sensors reporting the device on a single hub port.
+typedef struct {
+  uint8_t hub;
+  uint8_t port;
+#ifdef USE_BINARY_SENSOR
+  binary_sensor::BinarySensor *connected_sensor;
+#endif
+#ifdef USE_TEXT_SENSOR
+  text_sensor::TextSensor *info_sensor;
+#endif
+} USB_PORT_SENSORS;
 
 class MAX3421EComponent : public Component {
  public:
@@ -43,21 +111,89 @@ class MAX3421EComponent : public Component {
   void set_report_status_interval(uint32_t interval) { this->report_status_interval_ = interval; }
   void set_debug(bool debug) { this->debug_ = debug; }
   void set_debug_verbose(bool debug_verbose) { this->debug_verbose_ = debug_verbose; }
+  void set_device_tree_format(DeviceTreeFormat format) { this->device_tree_format_ = format; }
+  void set_hubs(uint8_t hubs) { this->hubs_count_ = hubs; }
+  void set_spi_backend(SPIBackendType backend) { this->spi_backend_type_ = backend; }
+  void set_spi_host(uint8_t host) { this->spi_host_ = host; }
+  void set_spi_pins(int8_t clk_pin, int8_t mosi_pin, int8_t miso_pin, uint8_t cs_pin) {
+    this->spi_clk_pin_ = clk_pin;
+    this->spi_mosi_pin_ = mosi_pin;
+    this->spi_miso_pin_ = miso_pin;
+    this->spi_cs_pin_ = cs_pin;
+  }
+  void set_spi_clock_speed(uint32_t clock_speed) { this->spi_clock_speed_ = clock_speed; }
+  void set_spi_benchmark(bool spi_benchmark) { this->spi_benchmark_ = spi_benchmark; }
+  // suspend the bus after the given time in ms without data transferred, 0 disables suspending.
+  void set_suspend_timeout(uint32_t suspend_timeout) { this->suspend_timeout_ = suspend_timeout; }
+  void set_remote_wakeup(bool remote_wakeup) { this->remote_wakeup_ = remote_wakeup; }
+  // remember the infos of up to size devices, so they are ready faster when attached again.
+  void set_device_cache(uint8_t size, DeviceCacheStorage storage) {
+    this->device_cache_.set_size(size);
+    this->device_cache_.set_storage(storage);
+  }
 #ifdef USE_BINARY_SENSOR
   void set_device_connected_sensor(binary_sensor::BinarySensor *device_connected_sensor) {
     this->device_connected_sensor_ = device_connected_sensor;
   }
+  void add_port_connected_sensor(uint8_t hub, uint8_t port, binary_sensor::BinarySensor *connected_sensor) {
+    this->getPortSensors(hub, port)->connected_sensor = connected_sensor;
+  }
+  void set_suspended_sensor(binary_sensor::BinarySensor *suspended_sensor) {
+    this->suspended_sensor_ = suspended_sensor;
+  }
 #endif
 #ifdef USE_TEXT_SENSOR
   void set_device_info_sensor(text_sensor::TextSensor *device_info_sensor) {
     this->device_info_sensor_ = device_info_sensor;
   }
+  void add_port_info_sensor(uint8_t hub, uint8_t port, text_sensor::TextSensor *info_sensor) {
+    this->getPortSensors(hub, port)->info_sensor = info_sensor;
+  }
+  void set_device_tree_sensor(text_sensor::TextSensor *device_tree_sensor) {
+    this->device_tree_sensor_ = device_tree_sensor;
+  }
 #endif
 
   uint8_t state() { return this->state_; }
   bool isConnected() { return this->state_ == USB_STATE_RUNNING; }
+  // returns true while the bus is not usable for transfers because it is suspended or resuming.
+  bool isSuspended() { return this->bus_state_ != BUS_STATE_ACTIVE; }
+  // function for class drivers to resume a suspended bus, e.g. because they have data to send.
+  // transfers are possible again once isSuspended() returns false.
+  void requestResume();
+  // returns the total time the bus was suspended in ms.
+  uint32_t getSuspendedTime() const;
+  // returns the time in ms the last known (from the device cache) or new device took to get ready, 0 if none did.
+  uint32_t getReadyTime(bool known) const { return this->ready_time_[known ? 1 : 0]; }
 
   USB *getUsb() { return this->usb; }
+  // SPI bus of the chip, for register sequences not covered by the USB library.
+  SPIBackend *getSpi() { return this->spi_; }
+
+  // statistics of the transfers done by this component and the class drivers reporting to it.
+  TransferStats *getStats() { return &this->stats_; }
+  // polls the interrupt and bulk IN endpoints the class drivers register, while the USB host is running.
+  EndpointScheduler *getScheduler() { return &this->scheduler_; }
+
+  // returns the known device with the given address or nullptr.
+  const USB_DEVICE_ENTRY *getDevice(uint8_t addr) const;
+  // returns the device attached to the given hub port or nullptr. hub 0 / port 0 is the root port.
+  const USB_DEVICE_ENTRY *getPortDevice(uint8_t hub, uint8_t port) const;
+
+  // returns the tree of all known devices with their configurations as JSON.
+  std::string deviceTreeJson();
+  // returns the tree of all known devices with their configurations in the compact binary format.
+  std::vector<uint8_t> deviceTreeBinary();
+  // returns the tree in the configured format, JSON or base64 encoded binary.
+  std::string deviceTree();
+  // returns a single line per tree fitting into a sensor state: hub.port VID:PID of each device.
+  std::string deviceTreeSummary();
+  // function to publish the device tree to the log and the on_device_tree callbacks, and its summary to the
+  // device tree sensor.
+  void publishDeviceTree();
+  void add_on_device_tree_callback(std::function<void(std::string)> &&callback) {
+    this->device_tree_callback_.add(std::move(callback));
+  }
 
   // function to read the device descriptor.
   //   call only when getUsb()->getUsbTaskState() >= USB_STATE_CONFIGURING
@@ -70,19 +206,79 @@ class MAX3421EComponent : public Component {
   HighFrequencyLoopRequester high_freq_;
 
   uint32_t report_status_interval_;
+  uint32_t last_report_{0};
+  uint32_t suspend_timeout_{0};
+  bool remote_wakeup_{true};
+  BusState bus_state_{BUS_STATE_ACTIVE};
+  uint32_t bus_state_since_{0};
+  uint32_t suspended_time_{0};  // of previous suspensions
+  // bytes transferred when the bus was seen busy the last time
+  uint32_t idle_bytes_{0};
+  uint32_t idle_since_{0};
   bool debug_ = false;
   bool debug_verbose_ = false;
 
   USB *usb;
-  // USBHub hub = USBHub(&Usb);
+  SPIBackend *spi_{nullptr};
+  SPIBackendType spi_backend_type_{SPI_BACKEND_ARDUINO};
+  uint8_t spi_host_{0};
+  int8_t spi_clk_pin_{-1};
+  int8_t spi_mosi_pin_{-1};
+  int8_t spi_miso_pin_{-1};
+  uint8_t spi_cs_pin_{0};
+  uint32_t spi_clock_speed_{26000000};
+  bool spi_benchmark_{false};
+  uint8_t hubs_count_{1};
+  std::vector<USBHub *> hubs_;
   uint8_t state_;
 
+  // devices currently in the address pool, updated incrementally each loop()
+  USB_DEVICE_ENTRY devices_[USB_NUMDEVICES]{};
+  std::vector<USB_PORT_SENSORS> port_sensors_;
+  // reads the device infos in the background, one transfer per loop()
+  DescriptorFetcher fetcher_;
+  TransferStats stats_;
+  EndpointScheduler scheduler_;
+  DeviceCache device_cache_;
+  // ready time of the last new and known device
+  uint32_t ready_time_[2]{};
+
 #ifdef USE_BINARY_SENSOR
   binary_sensor::BinarySensor *device_connected_sensor_{nullptr};
+  binary_sensor::BinarySensor *suspended_sensor_{nullptr};
 #endif
 #ifdef USE_TEXT_SENSOR
   text_sensor::TextSensor *device_info_sensor_{nullptr};
+  text_sensor::TextSensor *device_tree_sensor_{nullptr};
 #endif
+  DeviceTreeFormat device_tree_format_{DEVICE_TREE_FORMAT_JSON};
+  CallbackManager<void(std::string)> device_tree_callback_{};
+  // the device tree changed since it was published last
+  bool device_tree_dirty_{false};
+
+  USB_PORT_SENSORS *getPortSensors(uint8_t hub, uint8_t port);
+
+  // returns a new, not yet set up SPI backend of the given type with the configured pins.
+  SPIBackend *createSpiBackend(SPIBackendType type);
+  // function to benchmark the configured SPI backend, and the Arduino SPI library for comparison.
+  // the chip is initialized again afterwards.
+  void benchmarkSpi();
+
+  // function to sync the device table with the address pool of the USB host.
+  // only devices not known yet are queued for reading their infos.
+  void scanDevices();
+  // function to handle a device found in the address pool while scanning.
+  void onDeviceFound(UsbDevice *dev);
+  // function to forget a detached device and update its sensors.
+  void removeDevice(USB_DEVICE_ENTRY *entry);
+  // function to forget all devices.
+  void clearDevices();
+  // function to read the infos of queued devices, at most one transfer per call.
+  void readDeviceInfos();
+  // returns true if a device still waits for its infos being read.
+  bool hasPendingDeviceInfos() const;
+  // function to publish the sensors of the port the device is attached to.
+  void publishDevice(const USB_DEVICE_ENTRY *entry, bool connected);
 
   // function to dump the device descriptor.
   void dumpDevDesc(USB_DEVICE_DESCRIPTOR *devDesc);
@@ -94,13 +290,44 @@ class MAX3421EComponent : public Component {
   // function to dump the device descriptor strings.
   void dumpDevDescStrs(USB_DEVICE_DESCRIPTOR_STRINGS *devDescStrs);
 
-  // function to dump device full configuration descriptor.
+  // function to dump device full configuration descriptor, read from the device with blocking transfers.
+  //   only used by dumpDevice() at log level VERY_VERBOSE
   void dumpDevFullConfDesc(uint8_t addr, uint8_t conf);
 
-  // function to dump all devices.
-  // set verbose to dump all descriptors of the devices.
-  //   call only when getUsb()->getUsbTaskState() >= USB_STATE_CONFIGURING
-  void dumpDevices(bool verbose);
+  // function to dump a single descriptor of the configuration descriptor.
+  void dumpDescriptor(const uint8_t *desc, uint8_t desc_len);
+
+  // function to log a single line per known device from the infos read in the background.
+  void dumpDeviceSummary();
+
+  // function to log a single line per endpoint polled by the scheduler.
+  void dumpSchedule();
+
+  // function to suspend the bus once no data was transferred for the suspend timeout.
+  void checkIdle();
+  // function to stop the SOFs, after enabling remote wakeup on the devices supporting it.
+  void suspendBus();
+  // function to watch the suspended bus for remote wakeup and connection changes and to finish a resume.
+  void loopSuspended();
+  // function to enable remote wakeup on all devices with the attribute in their configuration.
+  void enableRemoteWakeup();
+  void setBusState(BusState state);
+
+  // function to dump a device from the infos read in the background, without transfers.
+  // set verbose to dump the device descriptor and the configuration summary.
+  void dumpDevice(const USB_DEVICE_ENTRY *entry, bool verbose);
+};
+
+class DeviceTreeTrigger : public Trigger<std::string> {
+ public:
+  explicit DeviceTreeTrigger(MAX3421EComponent *parent) {
+    parent->add_on_device_tree_callback([this](const std::string &tree) { this->trigger(tree); });
+  }
+};
+
+template<typename... Ts> class PublishDeviceTreeAction : public Action<Ts...>, public Parented<MAX3421EComponent> {
+ public:
+  void play(Ts... x) override { this->parent_->publishDeviceTree(); }
 };
 
 }  // namespace max3421e
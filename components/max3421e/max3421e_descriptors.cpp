@@ -0,0 +1,74 @@
+#include "max3421e_descriptors.h"
+
+namespace esphome {
+namespace max3421e {
+
+bool DescriptorRange::valid() const {
+  size_t walked = 0;
+  for (const DescriptorView &desc : *this) {
+    walked += desc.length();
+  }
+  return walked == this->size();
+}
+
+DescriptorRange DescriptorRange::configuration(uint8_t index) const {
+  const uint8_t *start = nullptr;
+  for (const DescriptorView &desc : *this) {
+    if (desc.type() != USB_DESCRIPTOR_CONFIGURATION) {
+      continue;
+    }
+    if (start != nullptr) {
+      return DescriptorRange(start, desc.data() - start);
+    }
+    if (index-- == 0) {
+      start = desc.data();
+    }
+  }
+  if (start == nullptr) {
+    return DescriptorRange(this->end_, 0);
+  }
+  return DescriptorRange(start, this->end_ - start);
+}
+
+const USB_INTERFACE_DESCRIPTOR *DescriptorRange::find_interface(uint16_t cls, uint16_t subclass,
+                                                                uint16_t protocol) const {
+  for (const DescriptorView &desc : *this) {
+    const auto *intf = desc.as<USB_INTERFACE_DESCRIPTOR>();
+    if (intf != nullptr && (cls == DESCRIPTOR_MATCH_ANY || intf->bInterfaceClass == cls) &&
+        (subclass == DESCRIPTOR_MATCH_ANY || intf->bInterfaceSubClass == subclass) &&
+        (protocol == DESCRIPTOR_MATCH_ANY || intf->bInterfaceProtocol == protocol)) {
+      return intf;
+    }
+  }
+  return nullptr;
+}
+
+DescriptorRange DescriptorRange::interface_descriptors(const USB_INTERFACE_DESCRIPTOR *intf) const {
+  const uint8_t *start = (const uint8_t *) intf;
+  if (intf == nullptr || start < this->begin_ || start + intf->bLength > this->end_) {
+    return DescriptorRange(this->end_, 0);
+  }
+  start += intf->bLength;
+  DescriptorRange rest(start, this->end_ - start);
+  for (const DescriptorView &desc : rest) {
+    if (desc.type() == USB_DESCRIPTOR_INTERFACE || desc.type() == USB_DESCRIPTOR_CONFIGURATION) {
+      return DescriptorRange(start, desc.data() - start);
+    }
+  }
+  return rest;
+}
+
+const USB_ENDPOINT_DESCRIPTOR *DescriptorRange::find_endpoint(const USB_INTERFACE_DESCRIPTOR *intf,
+                                                              uint8_t transfer_type, bool in) const {
+  for (const DescriptorView &desc : this->interface_descriptors(intf)) {
+    const auto *ep = desc.as<USB_ENDPOINT_DESCRIPTOR>();
+    if (ep != nullptr && (ep->bmAttributes & bmUSB_TRANSFER_TYPE) == transfer_type &&
+        ((ep->bEndpointAddress & 0x80) != 0) == in) {
+      return ep;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace max3421e
+}  // namespace esphome
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "Usb.h"
+#include "usbhub.h"
+
+namespace esphome {
+namespace max3421e {
+
+// class specific descriptor type of hubs (HubDescriptor).
+static const uint8_t USB_DESCRIPTOR_CLASS_HUB = 0x29;
+// matches any class, subclass or protocol in DescriptorRange::find_interface().
+static const uint16_t DESCRIPTOR_MATCH_ANY = 0x100;
+
+// descriptor type of the structs DescriptorView::as() can return.
+template<typename T> struct DescriptorType;
+template<> struct DescriptorType<USB_CONFIGURATION_DESCRIPTOR> {
+  static const uint8_t value = USB_DESCRIPTOR_CONFIGURATION;
+};
+template<> struct DescriptorType<USB_INTERFACE_DESCRIPTOR> {
+  static const uint8_t value = USB_DESCRIPTOR_INTERFACE;
+};
+template<> struct DescriptorType<USB_ENDPOINT_DESCRIPTOR> {
+  static const uint8_t value = USB_DESCRIPTOR_ENDPOINT;
+};
+template<> struct DescriptorType<HubDescriptor> {
+  static const uint8_t value = USB_DESCRIPTOR_CLASS_HUB;
+};
+
+// A single descriptor, pointing into the buffer it was found in. Its length is checked against the buffer.
+class DescriptorView {
+ public:
+  DescriptorView() = default;
+  DescriptorView(const uint8_t *data, uint8_t length) : data_(data), length_(length) {}
+
+  const uint8_t *data() const { return this->data_; }
+  uint8_t length() const { return this->length_; }
+  uint8_t type() const { return this->data_[1]; }
+
+  // returns the descriptor as T if it is of that type and long enough for it, otherwise nullptr.
+  template<typename T> const T *as() const {
+    if (this->length_ < sizeof(T) || this->type() != DescriptorType<T>::value) {
+      return nullptr;
+    }
+    return reinterpret_cast<const T *>(this->data_);  // the structs of the USB library are packed
+  }
+
+ protected:
+  const uint8_t *data_{nullptr};
+  uint8_t length_{0};
+};
+
+// Forward iterator over the descriptors in a buffer, ends early at a descriptor not fitting into the buffer.
+class DescriptorIterator {
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = DescriptorView;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const DescriptorView *;
+  using reference = const DescriptorView &;
+
+  DescriptorIterator(const uint8_t *pos, const uint8_t *end) : pos_(pos), end_(end) { this->check_(); }
+
+  reference operator*() const { return this->view_; }
+  pointer operator->() const { return &this->view_; }
+  DescriptorIterator &operator++() {
+    this->pos_ += this->view_.length();
+    this->check_();
+    return *this;
+  }
+  DescriptorIterator operator++(int) {
+    DescriptorIterator it = *this;
+    ++*this;
+    return it;
+  }
+  bool operator==(const DescriptorIterator &other) const { return this->pos_ == other.pos_; }
+  bool operator!=(const DescriptorIterator &other) const { return this->pos_ != other.pos_; }
+
+ protected:
+  void check_() {
+    size_t left = this->end_ - this->pos_;
+    // a descriptor has at least bLength and bDescriptorType and must not exceed the buffer
+    if (left < 2 || this->pos_[0] < 2 || this->pos_[0] > left) {
+      this->pos_ = this->end_;
+      this->view_ = DescriptorView();
+      return;
+    }
+    this->view_ = DescriptorView(this->pos_, this->pos_[0]);
+  }
+
+  const uint8_t *pos_;
+  const uint8_t *end_;
+  DescriptorView view_;
+};
+
+// Descriptors of one or more configurations as read from a device (e.g. USB_DEVICE_ENTRY::conf), without copying
+// them. Class drivers use it to find their interfaces and endpoints:
+//
+//   DescriptorRange descs(device->conf);
+//   auto *intf = descs.find_interface(USB_CLASS_HID, DESCRIPTOR_MATCH_ANY, USB_HID_PROTOCOL_KEYBOARD);
+//   auto *ep = descs.find_endpoint(intf, USB_TRANSFER_TYPE_INTERRUPT, true);
+//
+// The buffer must outlive the range and the descriptors returned from it.
+class DescriptorRange {
+ public:
+  DescriptorRange(const uint8_t *data, size_t len) : begin_(data), end_(data + len) {}
+  explicit DescriptorRange(const std::vector<uint8_t> &data) : DescriptorRange(data.data(), data.size()) {}
+
+  DescriptorIterator begin() const { return DescriptorIterator(this->begin_, this->end_); }
+  DescriptorIterator end() const { return DescriptorIterator(this->end_, this->end_); }
+  size_t size() const { return this->end_ - this->begin_; }
+
+  // true if the buffer consists of complete descriptors only.
+  bool valid() const;
+
+  // returns the first descriptor of type T or nullptr.
+  template<typename T> const T *first() const {
+    for (const DescriptorView &desc : *this) {
+      if (const T *d = desc.as<T>()) {
+        return d;
+      }
+    }
+    return nullptr;
+  }
+
+  // returns the descriptors of the configuration with the given index, starting with its configuration descriptor.
+  DescriptorRange configuration(uint8_t index) const;
+  // returns the first interface matching class, subclass and protocol (or DESCRIPTOR_MATCH_ANY) or nullptr.
+  const USB_INTERFACE_DESCRIPTOR *find_interface(uint16_t cls, uint16_t subclass = DESCRIPTOR_MATCH_ANY,
+                                                 uint16_t protocol = DESCRIPTOR_MATCH_ANY) const;
+  // returns the descriptors following the interface (class specific and endpoint descriptors) up to the next one.
+  //   intf has to be a descriptor of this range
+  DescriptorRange interface_descriptors(const USB_INTERFACE_DESCRIPTOR *intf) const;
+  // returns the first endpoint of the interface with the given transfer type and direction or nullptr.
+  const USB_ENDPOINT_DESCRIPTOR *find_endpoint(const USB_INTERFACE_DESCRIPTOR *intf, uint8_t transfer_type,
+                                               bool in) const;
+
+ protected:
+  const uint8_t *begin_;
+  const uint8_t *end_;
+};
+
+}  // namespace max3421e
+}  // namespace esphome
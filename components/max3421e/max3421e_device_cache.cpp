@@ -0,0 +1,112 @@
+#include "max3421e_device_cache.h"
+
+#include <cstring>
+#include <string>
+
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace max3421e {
+
+static const char *const TAG = "max3421e.cache";
+
+void DeviceCache::load() {
+  this->devices_.assign(this->size_, USB_KNOWN_DEVICE{});
+  this->prefs_.clear();
+  bool in_flash = this->storage_ == DEVICE_CACHE_STORAGE_FLASH;
+  for (uint8_t i = 0; i < this->size_; i++) {
+    uint32_t hash = fnv1_hash("max3421e_device_" + to_string(i)) ^ MAX3421E_DEVICE_CACHE_VERSION;
+    this->prefs_.push_back(global_preferences->make_preference<USB_KNOWN_DEVICE>(hash, in_flash));
+    USB_KNOWN_DEVICE &device = this->devices_[i];
+    if (!this->prefs_[i].load(&device) || device.conf_len > MAX3421E_DEVICE_CACHE_CONF_LEN) {
+      device = {};
+      continue;
+    }
+    device.manufacturer[MAX3421E_DEVICE_CACHE_STR_LEN - 1] = '\0';
+    device.product[MAX3421E_DEVICE_CACHE_STR_LEN - 1] = '\0';
+    if (device.sequence > this->sequence_) {
+      this->sequence_ = device.sequence;
+    }
+  }
+  ESP_LOGD(TAG, "Loaded %d known devices", this->count());
+}
+
+uint32_t DeviceCache::dev_desc_hash_(const USB_DEVICE_DESCRIPTOR &dev_desc) {
+  return fnv1_hash(std::string((const char *) &dev_desc, sizeof(dev_desc)));
+}
+
+const USB_KNOWN_DEVICE *DeviceCache::find(const USB_DEVICE_DESCRIPTOR &dev_desc, const char *serial) {
+  uint32_t serial_hash = fnv1_hash(serial);
+  for (auto &device : this->devices_) {
+    if (device.sequence == 0 || device.vid != dev_desc.idVendor || device.pid != dev_desc.idProduct ||
+        device.serial_hash != serial_hash) {
+      continue;
+    }
+    // e.g. a firmware update changes bcdDevice, the configuration may have changed along with it
+    if (device.dev_desc_hash != dev_desc_hash_(dev_desc)) {
+      ESP_LOGD(TAG, "Device descriptor of %04X:%04X changed", dev_desc.idVendor, dev_desc.idProduct);
+      break;
+    }
+    this->hits_++;
+    return &device;
+  }
+  this->misses_++;
+  return nullptr;
+}
+
+void DeviceCache::store(const USB_DEVICE_DESCRIPTOR &dev_desc, const char *serial, const char *manufacturer,
+                        const char *product, const std::vector<uint8_t> &conf) {
+  if (conf.size() > MAX3421E_DEVICE_CACHE_CONF_LEN) {
+    ESP_LOGD(TAG, "Configuration summary of %04X:%04X exceeds %d bytes, not remembered", dev_desc.idVendor,
+             dev_desc.idProduct, MAX3421E_DEVICE_CACHE_CONF_LEN);
+    return;
+  }
+  uint32_t serial_hash = fnv1_hash(serial);
+  // the same device with a changed descriptor, a free slot or the device stored first
+  size_t slot = 0;
+  for (size_t i = 0; i < this->devices_.size(); i++) {
+    const USB_KNOWN_DEVICE &device = this->devices_[i];
+    if (device.sequence != 0 && device.vid == dev_desc.idVendor && device.pid == dev_desc.idProduct &&
+        device.serial_hash == serial_hash) {
+      slot = i;
+      break;
+    }
+    if (device.sequence < this->devices_[slot].sequence) {
+      slot = i;
+    }
+  }
+  if (slot >= this->devices_.size()) {
+    return;
+  }
+
+  USB_KNOWN_DEVICE &device = this->devices_[slot];
+  device = {};
+  device.sequence = ++this->sequence_;
+  device.vid = dev_desc.idVendor;
+  device.pid = dev_desc.idProduct;
+  device.serial_hash = serial_hash;
+  device.dev_desc_hash = dev_desc_hash_(dev_desc);
+  strncpy(device.manufacturer, manufacturer, MAX3421E_DEVICE_CACHE_STR_LEN - 1);
+  strncpy(device.product, product, MAX3421E_DEVICE_CACHE_STR_LEN - 1);
+  device.conf_len = conf.size();
+  memcpy(device.conf, conf.data(), conf.size());
+  if (!this->prefs_[slot].save(&device)) {
+    ESP_LOGW(TAG, "Storing known device %04X:%04X failed", device.vid, device.pid);
+    return;
+  }
+  ESP_LOGD(TAG, "Remembered device %04X:%04X in slot %d", device.vid, device.pid, (int) slot);
+}
+
+uint8_t DeviceCache::count() const {
+  uint8_t count = 0;
+  for (auto &device : this->devices_) {
+    if (device.sequence != 0) {
+      count++;
+    }
+  }
+  return count;
+}
+
+}  // namespace max3421e
+}  // namespace esphome
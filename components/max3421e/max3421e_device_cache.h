@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+
+#include "esphome/core/preferences.h"
+
+#include "Usb.h"
+
+#ifndef MAX3421E_DEVICE_CACHE_STR_LEN
+// manufacturer and product kept per known device including the '\0'. With the cache enabled, the DescriptorFetcher
+// truncates longer ones already when reading them, so known and new devices report the same names.
+#define MAX3421E_DEVICE_CACHE_STR_LEN 32
+#endif
+#ifndef MAX3421E_DEVICE_CACHE_CONF_LEN
+// configuration summary kept per known device, devices with a longer one are not remembered.
+#define MAX3421E_DEVICE_CACHE_CONF_LEN 160
+#endif
+// changes with the layout of USB_KNOWN_DEVICE, so entries stored by older versions are dropped.
+#define MAX3421E_DEVICE_CACHE_VERSION 1
+
+namespace esphome {
+namespace max3421e {
+
+enum DeviceCacheStorage : uint8_t {
+  DEVICE_CACHE_STORAGE_FLASH = 0,
+  // survives resets but not power loss. ESP32 stores all preferences in flash.
+  DEVICE_CACHE_STORAGE_RTC,
+};
+
+// a device read completely before, stored as preference.
+typedef struct {
+  uint32_t sequence;  // order the devices were stored in, 0 marks a free slot
+  uint16_t vid;
+  uint16_t pid;
+  uint32_t serial_hash;    // fnv1 hash of the serial number, of "" if the device has none
+  uint32_t dev_desc_hash;  // fnv1 hash of the whole device descriptor, compared on attach
+  char manufacturer[MAX3421E_DEVICE_CACHE_STR_LEN];
+  char product[MAX3421E_DEVICE_CACHE_STR_LEN];
+  uint16_t conf_len;
+  uint8_t conf[MAX3421E_DEVICE_CACHE_CONF_LEN];  // configuration summary as read by the DescriptorFetcher
+} USB_KNOWN_DEVICE;
+
+// Persistent table of known devices keyed by VID, PID and serial number. A device found in it only has its
+// device descriptor and serial number read again, the rest of its infos is taken from the table.
+class DeviceCache {
+ public:
+  // number of devices remembered, 0 disables the table.
+  void set_size(uint8_t size) { this->size_ = size; }
+  void set_storage(DeviceCacheStorage storage) { this->storage_ = storage; }
+  // load the table from the preferences, call once from setup().
+  void load();
+  bool enabled() const { return this->size_ > 0; }
+  uint8_t size() const { return this->size_; }
+  DeviceCacheStorage storage() const { return this->storage_; }
+
+  // returns the known device with the VID, PID and serial number and the same device descriptor, or nullptr.
+  const USB_KNOWN_DEVICE *find(const USB_DEVICE_DESCRIPTOR &dev_desc, const char *serial);
+  // remember a device read completely, replacing the device stored first if the table is full.
+  void store(const USB_DEVICE_DESCRIPTOR &dev_desc, const char *serial, const char *manufacturer,
+             const char *product, const std::vector<uint8_t> &conf);
+
+  // number of devices in the table.
+  uint8_t count() const;
+  uint32_t hits() const { return this->hits_; }
+  uint32_t misses() const { return this->misses_; }
+
+ protected:
+  static uint32_t dev_desc_hash_(const USB_DEVICE_DESCRIPTOR &dev_desc);
+
+  uint8_t size_{0};
+  DeviceCacheStorage storage_{DEVICE_CACHE_STORAGE_FLASH};
+  uint32_t sequence_{0};
+  uint32_t hits_{0};
+  uint32_t misses_{0};
+  std::vector<USB_KNOWN_DEVICE> devices_;
+  std::vector<ESPPreferenceObject> prefs_;
+};
+
+}  // namespace max3421e
+}  // namespace esphome
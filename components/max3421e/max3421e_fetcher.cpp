@@ -0,0 +1,321 @@
+#include "max3421e_fetcher.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "esphome/core/log.h"
+
+#include "max3421e_parser.h"
+#include "max3421e_pgmstrings.h"
+
+namespace esphome {
+namespace max3421e {
+
+static const char *const TAG = "max3421e.fetcher";
+
+// str_len_ value requesting a header only read to learn the real string length.
+static const uint8_t STR_LEN_PROBE = 1;
+// length of the configuration descriptor without the descriptors following it.
+static const uint8_t CONF_DESCR_LEN = sizeof(USB_CONFIGURATION_DESCRIPTOR);
+
+const char *desc_fetch_stage_name(DescFetchStage stage) {
+  switch (stage) {
+    case DESC_FETCH_DEVICE:
+      return "device";
+    case DESC_FETCH_LANGID:
+      return "langid";
+    case DESC_FETCH_SERIAL:
+      return "serial";
+    case DESC_FETCH_MANUFACTURER:
+      return "manufacturer";
+    case DESC_FETCH_PRODUCT:
+      return "product";
+    case DESC_FETCH_CONFIG:
+      return "config";
+    case DESC_FETCH_IDLE:
+      return "idle";
+    case DESC_FETCH_DONE:
+      return "done";
+    case DESC_FETCH_FAILED:
+      return "failed";
+  }
+  return "unknown";
+}
+
+void DescriptorFetcher::start(uint8_t addr) {
+  this->reset();
+  this->addr_ = addr;
+  this->started_ms_ = millis();
+  this->stage_ = DESC_FETCH_DEVICE;
+}
+
+void DescriptorFetcher::reset() {
+  this->stage_ = DESC_FETCH_IDLE;
+  this->addr_ = 0;
+  this->rcode_ = 0;
+  this->langid_ = 0;
+  this->str_len_ = 0;
+  this->conf_index_ = 0;
+  this->conf_len_ = 0;
+  this->conf_full_ = false;
+  this->conf_truncated_ = false;
+  this->cached_ = false;
+  this->started_ms_ = 0;
+  this->finished_ms_ = 0;
+  for (auto &us : this->stage_us_) {
+    us = 0;
+  }
+  this->dev_desc_ = {};
+  this->dev_desc_strs_.iManufacturer[0] = '\0';
+  this->dev_desc_strs_.iProduct[0] = '\0';
+  this->dev_desc_strs_.iSerialNumber[0] = '\0';
+  this->conf_summary_.clear();
+}
+
+uint32_t DescriptorFetcher::transfer_time() const {
+  uint32_t total = 0;
+  for (auto us : this->stage_us_) {
+    total += us;
+  }
+  return total;
+}
+
+bool DescriptorFetcher::step(USB *usb) {
+  if (!this->busy()) {
+    return true;
+  }
+  DescFetchStage stage = this->stage_;
+  bool advance = true;
+  uint32_t start = micros();
+  switch (stage) {
+    case DESC_FETCH_DEVICE:
+      this->rcode_ = usb->getDevDescr(this->addr_, 0, DEV_DESCR_LEN, (uint8_t *) &this->dev_desc_);
+      this->record_(start, DEV_DESCR_LEN);
+      if (this->rcode_) {
+        ESP_LOGE(TAG, DevDescError, this->rcode_);
+      }
+      break;
+    case DESC_FETCH_LANGID:
+      // only the first language of the table is used, so the header and first entry are enough.
+      this->rcode_ = usb->getStrDescr(this->addr_, 0, 4, 0, 0, this->buf_);
+      this->record_(start, std::min(this->buf_[0], (uint8_t) 4));
+      if (this->rcode_) {
+        ESP_LOGE(TAG, DevDescStrErrFormat, DevDescStrErrTable, 0, this->rcode_);
+      } else if (this->buf_[0] < 4) {
+        // device has string indexes but no language, skip the strings.
+        this->stage_us_[stage] += micros() - start;
+        if (this->restore_()) {
+          this->finish_(DESC_FETCH_DONE);
+          return true;
+        }
+        if (this->dev_desc_.bNumConfigurations > 0) {
+          this->stage_ = DESC_FETCH_CONFIG;
+          return false;
+        }
+        this->finish_(DESC_FETCH_DONE);
+        return true;
+      } else {
+        this->langid_ = (this->buf_[3] << 8) | this->buf_[2];
+      }
+      break;
+    case DESC_FETCH_CONFIG:
+      advance = this->step_config_(usb);
+      break;
+    default:
+      advance = this->step_string_(usb, stage);
+      break;
+  }
+  this->stage_us_[stage] += micros() - start;
+
+  if (this->rcode_) {
+    this->finish_(DESC_FETCH_FAILED);
+  } else if (advance) {
+    DescFetchStage next = this->next_stage_(stage);
+    if (stage < DESC_FETCH_MANUFACTURER && next >= DESC_FETCH_MANUFACTURER && this->restore_()) {
+      next = DESC_FETCH_DONE;
+    }
+    if (next == DESC_FETCH_DONE) {
+      this->finish_(DESC_FETCH_DONE);
+    } else {
+      this->stage_ = next;
+    }
+  }
+  return !this->busy();
+}
+
+bool DescriptorFetcher::step_string_(USB *usb, DescFetchStage stage) {
+  uint8_t idx = this->string_index_(stage);
+  uint32_t start = micros();
+  if (this->str_len_ == STR_LEN_PROBE) {
+    this->rcode_ = usb->getStrDescr(this->addr_, 0, 2, idx, this->langid_, this->buf_);
+    this->record_(start, 2);
+    if (this->rcode_) {
+      ESP_LOGE(TAG, DevDescStrErrFormat, DevDescStrErrStringLength, idx, this->rcode_);
+      return false;
+    }
+    this->str_len_ = this->buf_[0] < 2 ? 2 : this->buf_[0];
+    return false;
+  }
+
+  // most devices answer a maximum sized request with a short packet, which saves the length read.
+  uint8_t requested = this->str_len_ ? this->str_len_ : MAX3421E_MAX_DESCRIPTOR_LEN;
+  this->rcode_ = usb->getStrDescr(this->addr_, 0, requested, idx, this->langid_, this->buf_);
+  this->record_(start, std::min(this->buf_[0], requested));
+  if (this->rcode_) {
+    if (this->str_len_ == 0) {
+      ESP_LOGD(TAG, "Reading string %d of device 0x%02X at once failed (0x%02X), retry with length", idx,
+               this->addr_, this->rcode_);
+      if (this->stats_ != nullptr) {
+        this->stats_->record_retry(this->addr_, STATS_CONTROL_ENDPOINT);
+      }
+      this->rcode_ = 0;
+      this->str_len_ = STR_LEN_PROBE;
+    } else {
+      ESP_LOGE(TAG, DevDescStrErrFormat, DevDescStrErrString, idx, this->rcode_);
+    }
+    return false;
+  }
+  this->str_len_ = 0;
+
+  uint8_t length = this->buf_[0] < requested ? this->buf_[0] : requested;
+  char *dest = this->string_dest_(stage);
+  // names are cut to the length kept by the device cache, so a device restored from it reports the same strings
+  size_t max_chars = MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN;
+  if (stage != DESC_FETCH_SERIAL && this->cache_ != nullptr && this->cache_->enabled()) {
+    max_chars = std::min(max_chars, (size_t) MAX3421E_DEVICE_CACHE_STR_LEN - 1);
+  }
+  // a 255 byte descriptor ends with half a character, which is dropped
+  size_t chars = 0;
+  for (size_t i = 2; i + 1 < length && chars < max_chars; i += 2) {
+    dest[chars++] = this->buf_[i];  // string is UTF-16LE encoded
+  }
+  dest[chars] = '\0';
+  return true;
+}
+
+bool DescriptorFetcher::step_config_(USB *usb) {
+  uint32_t start = micros();
+  if (this->conf_len_ == 0) {
+    // the header holds the length of the whole configuration, which is read in the next step
+    this->rcode_ = usb->getConfDescr(this->addr_, 0, CONF_DESCR_LEN, this->conf_index_, this->buf_);
+    this->record_(start, CONF_DESCR_LEN);
+    if (this->rcode_) {
+      ESP_LOGE(TAG, DevConfDescError, this->rcode_);
+      return false;
+    }
+    uint16_t total = this->buf_[2] | (this->buf_[3] << 8);
+    if (total > MAX3421E_MAX_CONF_DESCRIPTOR_LEN) {
+      ESP_LOGW(TAG, "Configuration %u of device 0x%02X has %u bytes, reading the first %d", this->conf_index_,
+               this->addr_, (unsigned) total, MAX3421E_MAX_CONF_DESCRIPTOR_LEN);
+      total = MAX3421E_MAX_CONF_DESCRIPTOR_LEN;
+      this->conf_truncated_ = true;
+    }
+    this->conf_len_ = std::max<uint16_t>(total, CONF_DESCR_LEN);
+    return false;
+  }
+
+  ConfDescParser parser([this](const uint8_t *desc, uint8_t len) {
+    if (this->conf_full_) {
+      return;
+    }
+    if (desc[1] != USB_DESCRIPTOR_CONFIGURATION && desc[1] != USB_DESCRIPTOR_INTERFACE &&
+        desc[1] != USB_DESCRIPTOR_ENDPOINT) {
+      return;
+    }
+    if (this->conf_summary_.size() + len > MAX3421E_MAX_CONF_SUMMARY_LEN) {
+      // later endpoints would be taken for those of the last interface kept
+      ESP_LOGW(TAG, "Configuration summary of device 0x%02X exceeds %d bytes, truncated", this->addr_,
+               MAX3421E_MAX_CONF_SUMMARY_LEN);
+      this->conf_full_ = true;
+      this->conf_truncated_ = true;
+      return;
+    }
+    this->conf_summary_.insert(this->conf_summary_.end(), desc, desc + len);
+  });
+  // a single control transfer of at most MAX3421E_MAX_CONF_DESCRIPTOR_LEN bytes, passed to the parser in chunks
+  this->rcode_ = usb->ctrlReq(this->addr_, 0, bmREQ_GET_DESCR, USB_REQUEST_GET_DESCRIPTOR, this->conf_index_,
+                              USB_DESCRIPTOR_CONFIGURATION, 0x0000, this->conf_len_, sizeof(this->buf_), this->buf_,
+                              &parser);
+  this->record_(start, parser.received());
+  if (this->rcode_) {
+    ESP_LOGE(TAG, DevConfDescError, this->rcode_);
+    return false;
+  }
+  this->conf_len_ = 0;
+  if (!this->conf_full_ && ++this->conf_index_ < this->dev_desc_.bNumConfigurations) {
+    return false;
+  }
+  return true;
+}
+
+DescFetchStage DescriptorFetcher::next_stage_(DescFetchStage stage) const {
+  for (uint8_t next = stage + 1; next < DESC_FETCH_STAGES; next++) {
+    if (next == DESC_FETCH_LANGID) {
+      if (this->dev_desc_.iManufacturer > 0 || this->dev_desc_.iProduct > 0 || this->dev_desc_.iSerialNumber > 0) {
+        return DESC_FETCH_LANGID;
+      }
+    } else if (next == DESC_FETCH_CONFIG) {
+      if (this->dev_desc_.bNumConfigurations > 0) {
+        return DESC_FETCH_CONFIG;
+      }
+    } else if (this->string_index_((DescFetchStage) next) > 0) {
+      return (DescFetchStage) next;
+    }
+  }
+  return DESC_FETCH_DONE;
+}
+
+uint8_t DescriptorFetcher::string_index_(DescFetchStage stage) const {
+  switch (stage) {
+    case DESC_FETCH_MANUFACTURER:
+      return this->dev_desc_.iManufacturer;
+    case DESC_FETCH_PRODUCT:
+      return this->dev_desc_.iProduct;
+    case DESC_FETCH_SERIAL:
+      return this->dev_desc_.iSerialNumber;
+    default:
+      return 0;
+  }
+}
+
+char *DescriptorFetcher::string_dest_(DescFetchStage stage) {
+  switch (stage) {
+    case DESC_FETCH_MANUFACTURER:
+      return this->dev_desc_strs_.iManufacturer;
+    case DESC_FETCH_PRODUCT:
+      return this->dev_desc_strs_.iProduct;
+    default:
+      return this->dev_desc_strs_.iSerialNumber;
+  }
+}
+
+void DescriptorFetcher::record_(uint32_t started, uint32_t bytes) {
+  if (this->stats_ != nullptr) {
+    this->stats_->record_since(this->addr_, STATS_CONTROL_ENDPOINT, this->rcode_, this->rcode_ ? 0 : bytes, started);
+  }
+}
+
+bool DescriptorFetcher::restore_() {
+  if (this->cache_ == nullptr || !this->cache_->enabled()) {
+    return false;
+  }
+  const USB_KNOWN_DEVICE *known = this->cache_->find(this->dev_desc_, this->dev_desc_strs_.iSerialNumber);
+  if (known == nullptr) {
+    return false;
+  }
+  strncpy(this->dev_desc_strs_.iManufacturer, known->manufacturer, MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN);
+  this->dev_desc_strs_.iManufacturer[MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN] = '\0';
+  strncpy(this->dev_desc_strs_.iProduct, known->product, MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN);
+  this->dev_desc_strs_.iProduct[MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN] = '\0';
+  this->conf_summary_.assign(known->conf, known->conf + known->conf_len);
+  this->cached_ = true;
+  return true;
+}
+
+void DescriptorFetcher::finish_(DescFetchStage stage) {
+  this->stage_ = stage;
+  this->finished_ms_ = millis();
+}
+
+}  // namespace max3421e
+}  // namespace esphome
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vector>
+
+#include "esphome/core/hal.h"
+
+#include "Usb.h"
+
+#include "max3421e_device_cache.h"
+#include "max3421e_stats.h"
+
+#define MAX3421E_MAX_DESCRIPTOR_LEN 0xFF
+// (MAX3421E_MAX_DESCRIPTOR_LEN - 1 (bLength byte) - 1 (bDescriptorType byte)) / 2 (2 bytes per UTF-16-LE char)
+#define MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN 126
+#ifndef MAX3421E_MAX_CONF_SUMMARY_LEN
+// configuration, interface and endpoint descriptors kept per device, enough for composite devices.
+#define MAX3421E_MAX_CONF_SUMMARY_LEN 512
+#endif
+#ifndef MAX3421E_MAX_CONF_DESCRIPTOR_LEN
+// bytes read of each configuration including class specific descriptors, longer ones are cut off.
+#define MAX3421E_MAX_CONF_DESCRIPTOR_LEN 1024
+#endif
+
+namespace esphome {
+namespace max3421e {
+
+typedef struct {
+  char iManufacturer[MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN + 1];  // +1 for '/0'
+  char iProduct[MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN + 1];       // +1 for '/0'
+  char iSerialNumber[MAX3421E_MAX_DESCRIPTOR_DATA_CHAR_LEN + 1];  // +1 for '/0'
+} USB_DEVICE_DESCRIPTOR_STRINGS;
+
+enum DescFetchStage : uint8_t {
+  DESC_FETCH_DEVICE = 0,
+  DESC_FETCH_LANGID,
+  // read before the other strings, a known device is complete with it
+  DESC_FETCH_SERIAL,
+  DESC_FETCH_MANUFACTURER,
+  DESC_FETCH_PRODUCT,
+  DESC_FETCH_CONFIG,
+  DESC_FETCH_STAGES,  // number of stages doing transfers
+  DESC_FETCH_IDLE = DESC_FETCH_STAGES,
+  DESC_FETCH_DONE,
+  DESC_FETCH_FAILED,
+};
+
+const char *desc_fetch_stage_name(DescFetchStage stage);
+
+// Resumable reader for the device descriptor, its strings and a summary of its configurations.
+// Every call to step() does at most one control transfer, so the caller can spread
+// the whole read over several loop() iterations instead of blocking until all strings are read.
+// A configuration takes two: its header, then the configuration up to MAX3421E_MAX_CONF_DESCRIPTOR_LEN bytes.
+// With a device cache, the read of a known device ends after its serial number.
+class DescriptorFetcher {
+ public:
+  // start reading the descriptors of the device with the given address.
+  void start(uint8_t addr);
+  // count the transfers in the given statistics.
+  void set_stats(TransferStats *stats) { this->stats_ = stats; }
+  // take the infos of known devices from the given cache.
+  void set_cache(DeviceCache *cache) { this->cache_ = cache; }
+  // abort any running read and forget the results.
+  void reset();
+  // run the next transfer. Returns true once the read has finished (done or failed).
+  //   call only when usb->getUsbTaskState() >= USB_STATE_CONFIGURING
+  bool step(USB *usb);
+
+  bool busy() const { return this->stage_ < DESC_FETCH_STAGES; }
+  bool done() const { return this->stage_ == DESC_FETCH_DONE; }
+  bool failed() const { return this->stage_ == DESC_FETCH_FAILED; }
+  // the read finished early with the infos of a known device from the cache.
+  bool cached() const { return this->cached_; }
+  DescFetchStage stage() const { return this->stage_; }
+  uint8_t address() const { return this->addr_; }
+  // result code of the last transfer
+  uint8_t rcode() const { return this->rcode_; }
+
+  const USB_DEVICE_DESCRIPTOR &dev_desc() const { return this->dev_desc_; }
+  const USB_DEVICE_DESCRIPTOR_STRINGS &dev_desc_strs() const { return this->dev_desc_strs_; }
+  // configuration, interface and endpoint descriptors of all configurations, back to back as read from the device.
+  // class specific descriptors are skipped.
+  const std::vector<uint8_t> &conf_summary() const { return this->conf_summary_; }
+  std::vector<uint8_t> &conf_summary() { return this->conf_summary_; }
+  // the summary ends early, because a configuration was longer than MAX3421E_MAX_CONF_DESCRIPTOR_LEN
+  // or the summary longer than MAX3421E_MAX_CONF_SUMMARY_LEN.
+  bool conf_truncated() const { return this->conf_truncated_; }
+
+  // time spent in the transfers of a stage in microseconds.
+  uint32_t stage_time(DescFetchStage stage) const { return stage < DESC_FETCH_STAGES ? this->stage_us_[stage] : 0; }
+  // time spent in all transfers in microseconds.
+  uint32_t transfer_time() const;
+  // wall clock time from start() until the read finished in milliseconds.
+  uint32_t elapsed_time() const { return this->finished_ms_ - this->started_ms_; }
+
+ protected:
+  // returns the next stage after the given one, skipping strings the device does not provide.
+  DescFetchStage next_stage_(DescFetchStage stage) const;
+  // index of the string descriptor read in the given stage.
+  uint8_t string_index_(DescFetchStage stage) const;
+  // destination of the string read in the given stage.
+  char *string_dest_(DescFetchStage stage);
+  // read (part of) the string of the given stage. Returns true once the string is complete.
+  bool step_string_(USB *usb, DescFetchStage stage);
+  // read the header or the rest of the next configuration. Returns true once all configurations are read.
+  bool step_config_(USB *usb);
+  // function to count the transfer just done with its result in rcode_.
+  void record_(uint32_t started, uint32_t bytes);
+  // take the remaining infos from the cache if the device is known. Returns true if it was.
+  bool restore_();
+  void finish_(DescFetchStage stage);
+
+  TransferStats *stats_{nullptr};
+  DeviceCache *cache_{nullptr};
+  DescFetchStage stage_{DESC_FETCH_IDLE};
+  uint8_t addr_{0};
+  uint8_t rcode_{0};
+  uint16_t langid_{0};
+  // 0 while the whole string is requested at once, otherwise the length reported by
+  // a previous header-only read for devices that do not like oversized requests.
+  uint8_t str_len_{0};
+  uint8_t conf_index_{0};
+  // 0 while the header of the configuration is read next, otherwise the bytes requested of it.
+  uint16_t conf_len_{0};
+  // the summary is full, descriptors read later are dropped.
+  bool conf_full_{false};
+  bool conf_truncated_{false};
+  bool cached_{false};
+  uint32_t started_ms_{0};
+  uint32_t finished_ms_{0};
+  uint32_t stage_us_[DESC_FETCH_STAGES]{};
+
+  USB_DEVICE_DESCRIPTOR dev_desc_{};
+  USB_DEVICE_DESCRIPTOR_STRINGS dev_desc_strs_{};
+  std::vector<uint8_t> conf_summary_;
+  uint8_t buf_[MAX3421E_MAX_DESCRIPTOR_LEN];
+};
+
+}  // namespace max3421e
+}  // namespace esphome
@@ -0,0 +1,41 @@
+#include "max3421e_parser.h"
+
+#include <cstring>
+
+namespace esphome {
+namespace max3421e {
+
+void ConfDescParser::Parse(const uint16_t len, const uint8_t *pbuf, const uint16_t &offset) {
+  this->received_ = (uint32_t) offset + len;
+  uint16_t i = 0;
+  while (i < len && !this->error_) {
+    uint16_t left = len - i;
+    if (this->held_ == 0) {
+      uint8_t desc_len = pbuf[i];
+      if (desc_len < 2) {
+        // a descriptor has at least bLength and bDescriptorType, anything shorter would loop forever
+        this->error_ = true;
+        return;
+      }
+      if (desc_len <= left) {
+        // descriptor completely within this chunk, no need to copy it
+        this->callback_(pbuf + i, desc_len);
+        i += desc_len;
+        continue;
+      }
+    }
+    // descriptor straddles the chunk boundary, collect it until complete
+    uint8_t need = this->held_ == 0 ? pbuf[i] : this->buf_[0] - this->held_;
+    uint16_t n = need < left ? need : left;
+    memcpy(this->buf_ + this->held_, pbuf + i, n);
+    this->held_ += n;
+    i += n;
+    if (this->held_ == this->buf_[0]) {
+      this->callback_(this->buf_, this->held_);
+      this->held_ = 0;
+    }
+  }
+}
+
+}  // namespace max3421e
+}  // namespace esphome
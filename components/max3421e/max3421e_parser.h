@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+
+#include "Usb.h"
+
+namespace esphome {
+namespace max3421e {
+
+// Streaming parser for configuration descriptors of any length (up to 64KB wTotalLength).
+// The descriptor is read in small chunks, each complete descriptor is passed to the callback.
+// Descriptors within a chunk are passed in place, only those straddling a chunk boundary are
+// collected in an internal buffer of the maximum descriptor size (bLength is a single byte).
+class ConfDescParser : public USBReadParser {
+ public:
+  using callback_t = std::function<void(const uint8_t *desc, uint8_t len)>;
+
+  explicit ConfDescParser(callback_t &&callback) : callback_(std::move(callback)) {}
+
+  // USBReadParser, called by the USB library for each chunk read.
+  void Parse(const uint16_t len, const uint8_t *pbuf, const uint16_t &offset) override;
+
+  // true if a descriptor with an invalid length stopped the parsing.
+  bool error() const { return this->error_; }
+  // bytes received so far.
+  uint32_t received() const { return this->received_; }
+  // true if the last descriptor was cut off at the end of the data.
+  bool incomplete() const { return this->held_ > 0; }
+
+ protected:
+  callback_t callback_;
+  uint8_t buf_[0xFF];
+  uint8_t held_{0};  // bytes of a straddling descriptor in buf_
+  bool error_{false};
+  uint32_t received_{0};
+};
+
+}  // namespace max3421e
+}  // namespace esphome
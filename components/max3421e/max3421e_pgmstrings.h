@@ -55,7 +55,7 @@ const char DevDescStrManufacturerFormat[] PROGMEM = /*******************/ "    M
 const char DevDescStrProductFormat[] PROGMEM = /************************/ "    Product:                 %s";
 const char DevDescStrSerialFormat[] PROGMEM = /*************************/ "    Serial:                  %s";
 
-const char DeviceConfDescLengthWarning[] PROGMEM = /********************/ "Configuration Descriptor with 0x%04X total length truncated to 0x%04X bytes";
+const char DevConfDescMalformedWarning[] PROGMEM = /********************/ "Configuration Descriptor malformed after 0x%04X bytes";
 const char DevConfDescError[] PROGMEM = /*******************************/ "Error getting device configuration descriptor. Error code: 0x%02X";
 
 const char DevConfDescHeader[] PROGMEM = /******************************/ "  Configuration descriptor:";
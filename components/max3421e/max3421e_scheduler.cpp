@@ -0,0 +1,123 @@
+#include "max3421e_scheduler.h"
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace max3421e {
+
+static const char *const TAG = "max3421e.scheduler";
+
+void EndpointScheduler::add(uint8_t addr, uint8_t ep, EndpointType type, uint8_t interval, EndpointPollFunc &&poll) {
+  this->remove(addr, ep);
+  USB_SCHEDULED_ENDPOINT entry{};
+  entry.address = addr;
+  entry.endpoint = ep;
+  entry.type = type;
+  entry.interval = interval > 0 ? interval : 1;
+  entry.backoff = 1;
+  entry.next_frame = millis();
+  entry.poll = std::move(poll);
+  ESP_LOGD(TAG, "Polling endpoint 0x%02X of device 0x%02X every %dms", ep, addr, entry.interval);
+  this->endpoints_.push_back(std::move(entry));
+}
+
+void EndpointScheduler::remove(uint8_t addr, uint8_t ep) {
+  for (auto it = this->endpoints_.begin(); it != this->endpoints_.end(); ++it) {
+    if (it->address == addr && it->endpoint == ep) {
+      this->removed_misses_ += it->misses;
+      this->endpoints_.erase(it);
+      return;
+    }
+  }
+}
+
+void EndpointScheduler::remove_device(uint8_t addr) {
+  for (auto it = this->endpoints_.begin(); it != this->endpoints_.end();) {
+    if (it->address == addr) {
+      this->removed_misses_ += it->misses;
+      it = this->endpoints_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void EndpointScheduler::run(uint32_t budget_us) {
+  uint32_t started = micros();
+  do {
+    uint32_t frame = millis();
+    USB_SCHEDULED_ENDPOINT *next = nullptr;
+    int32_t next_slack = 0;
+    for (auto &ep : this->endpoints_) {
+      if ((int32_t) (frame - ep.next_frame) < 0) {
+        continue;
+      }
+      // frames left until the poll misses its deadline
+      int32_t slack = (int32_t) (ep.next_frame + ep.interval - frame);
+      if (next == nullptr || slack < next_slack ||
+          (slack == next_slack && ep.type == ENDPOINT_INTERRUPT && next->type != ENDPOINT_INTERRUPT)) {
+        next = &ep;
+        next_slack = slack;
+      }
+    }
+    if (next == nullptr) {
+      return;
+    }
+    this->poll_(next, frame);
+  } while (micros() - started < budget_us);
+}
+
+void EndpointScheduler::poll_(USB_SCHEDULED_ENDPOINT *ep, uint32_t frame) {
+  uint32_t late = frame - ep->next_frame;
+  this->current_late_ = late;
+  uint32_t start = micros();
+  uint8_t rcode = ep->poll();
+  ep->busy_us += micros() - start;
+  ep->polls++;
+
+  if (late > ep->max_late) {
+    ep->max_late = late;
+  }
+  // the deadline is one interval after the poll was due. Frames are whole milliseconds, so a poll in the frame of
+  // its deadline may still be in time.
+  if (ep->type == ENDPOINT_INTERRUPT && late > ep->interval) {
+    ep->misses++;
+    ESP_LOGV(TAG, "Endpoint 0x%02X of device 0x%02X polled %ums late", ep->endpoint, ep->address, (unsigned) late);
+  }
+
+  if (rcode == hrNAK) {
+    ep->naks++;
+    if (ep->type == ENDPOINT_BULK && ep->backoff < MAX3421E_SCHEDULER_MAX_BACKOFF) {
+      ep->backoff *= 2;
+    }
+  } else {
+    if (rcode) {
+      ep->errors++;
+    }
+    ep->backoff = 1;
+  }
+  // counted from the deadline, so the interval doesn't drift with the time taken until the poll. Frames that
+  // passed meanwhile are skipped instead of being polled back to back.
+  uint32_t step = ep->interval * ep->backoff;
+  uint32_t next = ep->next_frame + step;
+  uint32_t now = millis();
+  if ((int32_t) (now - next) > 0) {
+    uint32_t skipped = (now - next + step - 1) / step;
+    ep->skipped += skipped;
+    next += skipped * step;
+  }
+  ep->next_frame = next;
+}
+
+uint32_t EndpointScheduler::misses(uint8_t addr, uint8_t ep) const {
+  uint32_t misses = addr == 0 && ep == 0xFF ? this->removed_misses_ : 0;
+  for (auto &entry : this->endpoints_) {
+    if ((addr == 0 || entry.address == addr) && (ep == 0xFF || entry.endpoint == ep)) {
+      misses += entry.misses;
+    }
+  }
+  return misses;
+}
+
+}  // namespace max3421e
+}  // namespace esphome
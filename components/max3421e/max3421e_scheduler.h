@@ -0,0 +1,84 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "esphome/core/hal.h"
+
+#include "Usb.h"
+
+#ifndef MAX3421E_SCHEDULER_BUDGET_US
+// time a single loop() may spend polling endpoints.
+#define MAX3421E_SCHEDULER_BUDGET_US 2000
+#endif
+#ifndef MAX3421E_SCHEDULER_MAX_BACKOFF
+// bulk endpoints answering with NAK are polled up to this many times less often.
+#define MAX3421E_SCHEDULER_MAX_BACKOFF 8
+#endif
+
+namespace esphome {
+namespace max3421e {
+
+enum EndpointType : uint8_t {
+  // polled every interval, a poll a whole frame past its deadline (one interval after it was due) is a miss
+  ENDPOINT_INTERRUPT = 0,
+  // polled every interval while it has data, backing off while it answers with NAK
+  ENDPOINT_BULK,
+};
+
+// poll function of an endpoint, does the transfer(s) and returns the result code.
+// hrNAK means the device had no data. It must not add or remove endpoints.
+using EndpointPollFunc = std::function<uint8_t()>;
+
+typedef struct {
+  uint8_t address;
+  uint8_t endpoint;  // endpoint address with direction bit
+  EndpointType type;
+  uint8_t interval;     // frames between polls, from bInterval for interrupt endpoints
+  uint8_t backoff;      // current interval multiplier of bulk endpoints
+  uint32_t next_frame;  // frame the next poll is due
+  uint32_t polls;
+  uint32_t naks;
+  uint32_t errors;
+  uint32_t misses;    // polls a whole frame past their deadline
+  uint32_t max_late;  // frames the latest poll was late
+  uint32_t skipped;   // polls left out because their frame had passed
+  uint32_t busy_us;   // time spent in polls
+  EndpointPollFunc poll;
+} USB_SCHEDULED_ENDPOINT;
+
+// Polls the interrupt and bulk IN endpoints registered by the class drivers, so they share the MAX3421E instead
+// of polling from their own loop(). Frames are the 1ms ticks of millis(), matching full and low speed USB frames;
+// the chip has no readable frame counter. Due endpoints are polled earliest deadline first, interrupt endpoints
+// before bulk ones, within a time budget per call.
+class EndpointScheduler {
+ public:
+  // register an endpoint, replacing a previous registration of the same device endpoint.
+  void add(uint8_t addr, uint8_t ep, EndpointType type, uint8_t interval, EndpointPollFunc &&poll);
+  void remove(uint8_t addr, uint8_t ep);
+  // remove all endpoints of a detached device.
+  void remove_device(uint8_t addr);
+
+  // poll the due endpoints until none is due anymore or the budget is used up.
+  void run(uint32_t budget_us);
+
+  const std::vector<USB_SCHEDULED_ENDPOINT> &endpoints() const { return this->endpoints_; }
+  // deadline misses of the endpoints matching the filter, 0 matches any address and 0xFF any endpoint.
+  // the misses of all devices include the ones of removed endpoints.
+  uint32_t misses(uint8_t addr, uint8_t ep) const;
+  // frames the endpoint being polled is late, for poll functions.
+  uint32_t current_late() const { return this->current_late_; }
+
+  // frames between polls of an interrupt endpoint of a full or low speed device.
+  static uint8_t interval_frames(uint8_t bInterval) { return bInterval > 0 ? bInterval : 1; }
+
+ protected:
+  void poll_(USB_SCHEDULED_ENDPOINT *ep, uint32_t frame);
+
+  std::vector<USB_SCHEDULED_ENDPOINT> endpoints_;
+  uint32_t removed_misses_{0};
+  uint32_t current_late_{0};
+};
+
+}  // namespace max3421e
+}  // namespace esphome
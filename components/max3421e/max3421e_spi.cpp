@@ -0,0 +1,312 @@
+#include "max3421e_spi.h"
+#include "max3421e_usb_spi.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "esphome/core/log.h"
+
+#ifdef USE_ESP32
+#include <driver/gpio.h>
+#include <esp_heap_caps.h>
+#endif
+
+namespace esphome {
+namespace max3421e {
+
+static const char *const TAG = "max3421e.spi";
+
+USBSPI usb_spi;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+const char *spi_backend_name(SPIBackendType type) {
+  switch (type) {
+    case SPI_BACKEND_ARDUINO:
+      return "arduino";
+    case SPI_BACKEND_ESP_IDF:
+      return "esp_idf";
+  }
+  return "unknown";
+}
+
+void SPIBackend::write_registers(const SPI_REG_WRITE *writes, size_t count) {
+  this->begin_transaction();
+  for (size_t i = 0; i < count; i++) {
+    this->set_cs_(true);
+    this->transfer(writes[i].reg | SPI_REG_WRITE_BIT);
+    this->transfer(writes[i].value);
+    this->set_cs_(false);
+  }
+  this->end_transaction();
+}
+
+bool ArduinoSPIBackend::setup() {
+#ifdef USE_ESP32
+  if (this->clk_pin_ >= 0) {
+    SPI.begin(this->clk_pin_, this->miso_pin_, this->mosi_pin_);
+  } else {
+    SPI.begin();
+  }
+#else
+  SPI.begin();
+#endif
+  pinMode(this->cs_pin_, OUTPUT);
+  digitalWrite(this->cs_pin_, HIGH);
+  return true;
+}
+
+void ArduinoSPIBackend::teardown() { SPI.end(); }
+
+void ArduinoSPIBackend::begin_transaction() {
+  SPI.beginTransaction(SPISettings(this->clock_speed_, MSBFIRST, SPI_MODE0));
+}
+
+void ArduinoSPIBackend::end_transaction() { SPI.endTransaction(); }
+
+uint8_t ArduinoSPIBackend::transfer(uint8_t data) { return SPI.transfer(data); }
+
+void ArduinoSPIBackend::write_bytes(const uint8_t *data, size_t len) { SPI.writeBytes(data, len); }
+
+void ArduinoSPIBackend::read_bytes(uint8_t *data, size_t len) { SPI.transferBytes(nullptr, data, len); }
+
+void ArduinoSPIBackend::transfer_bytes(uint8_t *data, size_t len) { SPI.transfer(data, len); }
+
+void ArduinoSPIBackend::set_cs_(bool active) { digitalWrite(this->cs_pin_, active ? LOW : HIGH); }
+
+#ifdef USE_ESP32
+bool IDFSPIBackend::setup() {
+  if (this->dma_buf_ == nullptr) {
+    this->dma_buf_ = (uint8_t *) heap_caps_malloc(MAX3421E_SPI_DMA_BUF_LEN, MALLOC_CAP_DMA);
+    if (this->dma_buf_ == nullptr) {
+      ESP_LOGE(TAG, "Allocating the DMA buffer failed");
+      return false;
+    }
+  }
+
+  spi_bus_config_t buscfg = {};
+  buscfg.mosi_io_num = this->mosi_pin_;
+  buscfg.miso_io_num = this->miso_pin_;
+  buscfg.sclk_io_num = this->clk_pin_;
+  buscfg.quadwp_io_num = -1;
+  buscfg.quadhd_io_num = -1;
+  buscfg.max_transfer_sz = MAX3421E_SPI_DMA_BUF_LEN;
+  esp_err_t err = spi_bus_initialize(this->host_, &buscfg, SPI_DMA_CH_AUTO);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "spi_bus_initialize failed: %s", esp_err_to_name(err));
+    return false;
+  }
+
+  // the chip select stays with the USB library, which frames whole register accesses with it
+  spi_device_interface_config_t devcfg = {};
+  devcfg.mode = 0;
+  devcfg.clock_speed_hz = this->clock_speed_;
+  devcfg.spics_io_num = -1;
+  devcfg.queue_size = MAX3421E_SPI_QUEUE_SIZE;
+  devcfg.pre_cb = IDFSPIBackend::pre_transfer_;
+  devcfg.post_cb = IDFSPIBackend::post_transfer_;
+  err = spi_bus_add_device(this->host_, &devcfg, &this->handle_);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "spi_bus_add_device failed: %s", esp_err_to_name(err));
+    spi_bus_free(this->host_);
+    return false;
+  }
+
+  gpio_set_direction((gpio_num_t) this->cs_pin_, GPIO_MODE_OUTPUT);
+  gpio_set_level((gpio_num_t) this->cs_pin_, 1);
+  return true;
+}
+
+void IDFSPIBackend::teardown() {
+  if (this->handle_ == nullptr) {
+    return;
+  }
+  spi_bus_remove_device(this->handle_);
+  spi_bus_free(this->host_);
+  this->handle_ = nullptr;
+}
+
+void IDFSPIBackend::begin_transaction() {
+  if (spi_device_acquire_bus(this->handle_, portMAX_DELAY) == ESP_OK) {
+    this->bus_acquired_ = true;
+  }
+}
+
+void IDFSPIBackend::end_transaction() {
+  if (this->bus_acquired_) {
+    spi_device_release_bus(this->handle_);
+    this->bus_acquired_ = false;
+  }
+}
+
+uint8_t IDFSPIBackend::transfer(uint8_t data) {
+  spi_transaction_t trans = {};
+  trans.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+  trans.length = 8;
+  trans.tx_data[0] = data;
+  spi_device_polling_transmit(this->handle_, &trans);
+  return trans.rx_data[0];
+}
+
+void IDFSPIBackend::write_bytes(const uint8_t *data, size_t len) {
+  while (len > 0) {
+    size_t chunk = std::min(len, (size_t) MAX3421E_SPI_DMA_BUF_LEN);
+    memcpy(this->dma_buf_, data, chunk);
+    spi_transaction_t trans = {};
+    trans.length = chunk * 8;
+    trans.tx_buffer = this->dma_buf_;
+    spi_device_polling_transmit(this->handle_, &trans);
+    data += chunk;
+    len -= chunk;
+  }
+}
+
+void IDFSPIBackend::read_bytes(uint8_t *data, size_t len) {
+  while (len > 0) {
+    size_t chunk = std::min(len, (size_t) MAX3421E_SPI_DMA_BUF_LEN);
+    spi_transaction_t trans = {};
+    trans.length = chunk * 8;
+    trans.rxlength = chunk * 8;
+    trans.rx_buffer = this->dma_buf_;
+    spi_device_polling_transmit(this->handle_, &trans);
+    memcpy(data, this->dma_buf_, chunk);
+    data += chunk;
+    len -= chunk;
+  }
+}
+
+void IDFSPIBackend::transfer_bytes(uint8_t *data, size_t len) {
+  if (len <= 4) {
+    spi_transaction_t trans = {};
+    trans.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+    trans.length = len * 8;
+    memcpy(trans.tx_data, data, len);
+    spi_device_polling_transmit(this->handle_, &trans);
+    memcpy(data, trans.rx_data, len);
+    return;
+  }
+  // the halves of the DMA buffer take the bytes written and read
+  const size_t half = MAX3421E_SPI_DMA_BUF_LEN / 2;
+  while (len > 0) {
+    size_t chunk = std::min(len, half);
+    memcpy(this->dma_buf_, data, chunk);
+    spi_transaction_t trans = {};
+    trans.length = chunk * 8;
+    trans.rxlength = chunk * 8;
+    trans.tx_buffer = this->dma_buf_;
+    trans.rx_buffer = this->dma_buf_ + half;
+    spi_device_polling_transmit(this->handle_, &trans);
+    memcpy(data, this->dma_buf_ + half, chunk);
+    data += chunk;
+    len -= chunk;
+  }
+}
+
+void IDFSPIBackend::write_registers(const SPI_REG_WRITE *writes, size_t count) {
+  spi_transaction_t trans[MAX3421E_SPI_QUEUE_SIZE];
+  while (count > 0) {
+    size_t queued = 0;
+    for (; queued < count && queued < MAX3421E_SPI_QUEUE_SIZE; queued++) {
+      trans[queued] = {};
+      trans[queued].flags = SPI_TRANS_USE_TXDATA;
+      trans[queued].length = 16;
+      trans[queued].tx_data[0] = writes[queued].reg | SPI_REG_WRITE_BIT;
+      trans[queued].tx_data[1] = writes[queued].value;
+      trans[queued].user = this;
+      if (spi_device_queue_trans(this->handle_, &trans[queued], portMAX_DELAY) != ESP_OK) {
+        break;
+      }
+    }
+    spi_transaction_t *done;
+    for (size_t i = 0; i < queued; i++) {
+      spi_device_get_trans_result(this->handle_, &done, portMAX_DELAY);
+    }
+    if (queued == 0) {
+      ESP_LOGE(TAG, "Queueing register writes failed");
+      return;
+    }
+    writes += queued;
+    count -= queued;
+  }
+}
+
+void IDFSPIBackend::set_cs_(bool active) { gpio_set_level((gpio_num_t) this->cs_pin_, active ? 0 : 1); }
+
+void IRAM_ATTR IDFSPIBackend::pre_transfer_(spi_transaction_t *trans) {
+  if (trans->user != nullptr) {
+    gpio_set_level((gpio_num_t) ((IDFSPIBackend *) trans->user)->cs_pin_, 0);
+  }
+}
+
+void IRAM_ATTR IDFSPIBackend::post_transfer_(spi_transaction_t *trans) {
+  if (trans->user != nullptr) {
+    gpio_set_level((gpio_num_t) ((IDFSPIBackend *) trans->user)->cs_pin_, 1);
+  }
+}
+#endif
+
+void spi_benchmark(USB *usb, SPIBackend *spi) {
+  uint8_t buf[MAX3421E_SPI_DMA_BUF_LEN];
+  memset(buf, 0xA5, sizeof(buf));
+  SPI_REG_WRITE writes[MAX3421E_SPI_QUEUE_SIZE];
+  for (auto &w : writes) {
+    w = {rPERADDR, 0};
+  }
+
+  // SNDFIFO takes any data until SNDBC commits it, RCVFIFO can be read even if empty
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < MAX3421E_SPI_BENCHMARK_ROUNDS; i++) {
+    usb->bytesWr(rSNDFIFO, sizeof(buf), buf);
+  }
+  uint32_t write_us = micros() - start;
+  start = micros();
+  for (uint16_t i = 0; i < MAX3421E_SPI_BENCHMARK_ROUNDS; i++) {
+    usb->bytesRd(rRCVFIFO, sizeof(buf), buf);
+  }
+  uint32_t read_us = micros() - start;
+  start = micros();
+  for (uint16_t i = 0; i < MAX3421E_SPI_BENCHMARK_ROUNDS; i++) {
+    usb->regRd(rREVISION);
+  }
+  uint32_t reg_read_us = micros() - start;
+  start = micros();
+  for (uint16_t i = 0; i < MAX3421E_SPI_BENCHMARK_ROUNDS; i++) {
+    usb->regWr(rPERADDR, 0);
+  }
+  uint32_t reg_write_us = micros() - start;
+  start = micros();
+  for (uint16_t i = 0; i < MAX3421E_SPI_BENCHMARK_ROUNDS / MAX3421E_SPI_QUEUE_SIZE; i++) {
+    spi->write_registers(writes, MAX3421E_SPI_QUEUE_SIZE);
+  }
+  uint32_t burst_us = micros() - start;
+
+  uint32_t bytes = MAX3421E_SPI_BENCHMARK_ROUNDS * sizeof(buf);
+  ESP_LOGI(TAG, "Benchmark %s SPI at %u Hz:", spi_backend_name(spi->type()), (unsigned) spi->clock_speed());
+  ESP_LOGI(TAG, "  FIFO write:     %.0f kB/s", bytes * 1000.0f / std::max<uint32_t>(write_us, 1));
+  ESP_LOGI(TAG, "  FIFO read:      %.0f kB/s", bytes * 1000.0f / std::max<uint32_t>(read_us, 1));
+  ESP_LOGI(TAG, "  Register read:  %.2f us", (float) reg_read_us / MAX3421E_SPI_BENCHMARK_ROUNDS);
+  ESP_LOGI(TAG, "  Register write: %.2f us", (float) reg_write_us / MAX3421E_SPI_BENCHMARK_ROUNDS);
+  ESP_LOGI(TAG, "  Register burst: %.2f us per register", (float) burst_us / MAX3421E_SPI_BENCHMARK_ROUNDS);
+}
+
+void USBSPI::beginTransaction(SPISettings settings) { this->backend_->begin_transaction(); }
+
+void USBSPI::endTransaction() { this->backend_->end_transaction(); }
+
+uint8_t USBSPI::transfer(uint8_t data) { return this->backend_->transfer(data); }
+
+void USBSPI::transfer(void *data, uint32_t size) { this->backend_->transfer_bytes((uint8_t *) data, size); }
+
+void USBSPI::writeBytes(const uint8_t *data, uint32_t size) { this->backend_->write_bytes(data, size); }
+
+void USBSPI::transferBytes(const uint8_t *data, uint8_t *out, uint32_t size) {
+  if (data != nullptr && out == nullptr) {
+    this->backend_->write_bytes(data, size);
+  } else if (data == nullptr && out != nullptr) {
+    this->backend_->read_bytes(out, size);
+  } else if (data != nullptr) {
+    memcpy(out, data, size);
+    this->backend_->transfer_bytes(out, size);
+  }
+}
+
+}  // namespace max3421e
+}  // namespace esphome
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+
+#include <SPI.h>
+#ifdef USE_ESP32
+#include <driver/spi_master.h>
+#endif
+
+#include "Usb.h"
+
+#ifndef MAX3421E_SPI_DMA_BUF_LEN
+// FIFO accesses of the USB library are at most one packet, multiple of 4 for the ESP32 DMA.
+#define MAX3421E_SPI_DMA_BUF_LEN 64
+#endif
+#ifndef MAX3421E_SPI_QUEUE_SIZE
+// register writes queued at once by write_registers()
+#define MAX3421E_SPI_QUEUE_SIZE 8
+#endif
+// FIFO transfers done per direction by spi_benchmark()
+#define MAX3421E_SPI_BENCHMARK_ROUNDS 256
+
+namespace esphome {
+namespace max3421e {
+
+// command bit of the MAX3421E selecting a register write.
+static const uint8_t SPI_REG_WRITE_BIT = 0x02;
+
+enum SPIBackendType : uint8_t {
+  // Arduino SPI library, byte by byte
+  SPI_BACKEND_ARDUINO = 0,
+  // ESP-IDF spi_master with DMA for FIFO accesses and queued register writes
+  SPI_BACKEND_ESP_IDF,
+};
+
+const char *spi_backend_name(SPIBackendType type);
+
+typedef struct {
+  uint8_t reg;  // register as defined by the USB library (e.g. rPERADDR), without the write bit
+  uint8_t value;
+} SPI_REG_WRITE;
+
+// Access to the SPI bus of the MAX3421E. The USB library calls transfer(), write_bytes() and read_bytes()
+// between begin_transaction() and end_transaction() and handles the chip select itself.
+class SPIBackend {
+ public:
+  SPIBackend(int8_t clk_pin, int8_t mosi_pin, int8_t miso_pin, uint8_t cs_pin, uint32_t clock_speed)
+      : clk_pin_(clk_pin), mosi_pin_(mosi_pin), miso_pin_(miso_pin), cs_pin_(cs_pin), clock_speed_(clock_speed) {}
+  virtual ~SPIBackend() = default;
+
+  virtual SPIBackendType type() const = 0;
+  // claim the bus and route the pins to it.
+  virtual bool setup() = 0;
+  // release the bus and its pins, setup() can be called again afterwards.
+  virtual void teardown() = 0;
+
+  virtual void begin_transaction() {}
+  virtual void end_transaction() {}
+  virtual uint8_t transfer(uint8_t data) = 0;
+  virtual void write_bytes(const uint8_t *data, size_t len) = 0;
+  virtual void read_bytes(uint8_t *data, size_t len) = 0;
+  // full duplex in place, the bytes read replace the ones written.
+  virtual void transfer_bytes(uint8_t *data, size_t len) = 0;
+
+  // write a sequence of registers, each framed by its own chip select.
+  virtual void write_registers(const SPI_REG_WRITE *writes, size_t count);
+
+  uint32_t clock_speed() const { return this->clock_speed_; }
+
+ protected:
+  virtual void set_cs_(bool active) = 0;
+
+  int8_t clk_pin_;  // -1 for the default pins of the platform
+  int8_t mosi_pin_;
+  int8_t miso_pin_;
+  uint8_t cs_pin_;  // only used by write_registers(), the USB library drives its own
+  uint32_t clock_speed_;
+};
+
+class ArduinoSPIBackend : public SPIBackend {
+ public:
+  using SPIBackend::SPIBackend;
+
+  SPIBackendType type() const override { return SPI_BACKEND_ARDUINO; }
+  bool setup() override;
+  void teardown() override;
+
+  void begin_transaction() override;
+  void end_transaction() override;
+  uint8_t transfer(uint8_t data) override;
+  void write_bytes(const uint8_t *data, size_t len) override;
+  void read_bytes(uint8_t *data, size_t len) override;
+  void transfer_bytes(uint8_t *data, size_t len) override;
+
+ protected:
+  void set_cs_(bool active) override;
+};
+
+#ifdef USE_ESP32
+class IDFSPIBackend : public SPIBackend {
+ public:
+  IDFSPIBackend(spi_host_device_t host, int8_t clk_pin, int8_t mosi_pin, int8_t miso_pin, uint8_t cs_pin,
+                uint32_t clock_speed)
+      : SPIBackend(clk_pin, mosi_pin, miso_pin, cs_pin, clock_speed), host_(host) {}
+
+  SPIBackendType type() const override { return SPI_BACKEND_ESP_IDF; }
+  bool setup() override;
+  void teardown() override;
+
+  // keeps the bus for the whole register access, so the polling transactions skip the arbitration.
+  void begin_transaction() override;
+  void end_transaction() override;
+  uint8_t transfer(uint8_t data) override;
+  void write_bytes(const uint8_t *data, size_t len) override;
+  void read_bytes(uint8_t *data, size_t len) override;
+  // register accesses of up to 4 bytes go without DMA.
+  void transfer_bytes(uint8_t *data, size_t len) override;
+
+  void write_registers(const SPI_REG_WRITE *writes, size_t count) override;
+
+ protected:
+  void set_cs_(bool active) override;
+  // chip select of queued register writes, the transaction user field holds the backend.
+  static void pre_transfer_(spi_transaction_t *trans);
+  static void post_transfer_(spi_transaction_t *trans);
+
+  spi_host_device_t host_;
+  spi_device_handle_t handle_{nullptr};
+  bool bus_acquired_{false};
+  // DMA capable bounce buffer for FIFO accesses
+  uint8_t *dma_buf_{nullptr};
+};
+#endif
+
+// function to measure the FIFO throughput and register latency through the USB library with the given backend.
+// fills the FIFOs with garbage, the chip has to be initialized again afterwards.
+void spi_benchmark(USB *usb, SPIBackend *spi);
+
+}  // namespace max3421e
+}  // namespace esphome
@@ -0,0 +1,131 @@
+#include "max3421e_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace esphome {
+namespace max3421e {
+
+void TransferStats::record(uint8_t addr, uint8_t ep, uint8_t rcode, uint32_t bytes, uint32_t latency_us) {
+  add_(&this->total_, rcode, bytes, latency_us);
+  USB_TRANSFER_STATS *stats = this->get_(addr, ep);
+  if (stats != nullptr) {
+    add_(stats, rcode, bytes, latency_us);
+  }
+}
+
+void TransferStats::record_retry(uint8_t addr, uint8_t ep) {
+  this->total_.retries++;
+  USB_TRANSFER_STATS *stats = this->get_(addr, ep);
+  if (stats != nullptr) {
+    stats->retries++;
+  }
+}
+
+void TransferStats::forget(uint8_t addr) {
+  for (auto it = this->endpoints_.begin(); it != this->endpoints_.end();) {
+    if (it->address == addr) {
+      it = this->endpoints_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void TransferStats::sum(uint8_t addr, uint8_t ep, USB_TRANSFER_STATS *out) const {
+  *out = {};
+  out->address = addr;
+  out->endpoint = ep;
+  if (addr == 0 && ep == 0xFF) {
+    // also counts the endpoints not tracked individually
+    *out = this->total_;
+    return;
+  }
+  for (auto &stats : this->endpoints_) {
+    if ((addr == 0 || stats.address == addr) && (ep == 0xFF || stats.endpoint == ep)) {
+      merge_(out, stats);
+    }
+  }
+}
+
+uint32_t TransferStats::latency_percentile(const USB_TRANSFER_STATS &stats, float percent) {
+  uint32_t count = 0;
+  for (auto n : stats.latency_hist) {
+    count += n;
+  }
+  if (count == 0) {
+    return 0;
+  }
+  // the rank of the sample, rounded up so few samples don't always end in the first bucket
+  uint32_t limit = std::max<uint32_t>(ceilf(count * percent / 100.0f), 1);
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < MAX3421E_STATS_LATENCY_BUCKETS; i++) {
+    seen += stats.latency_hist[i];
+    if (seen >= limit) {
+      // the last bucket has no upper bound, the maximum is the best guess
+      return i + 1 < MAX3421E_STATS_LATENCY_BUCKETS ? latency_bucket_limit(i) : stats.latency_max_us;
+    }
+  }
+  return stats.latency_max_us;
+}
+
+USB_TRANSFER_STATS *TransferStats::get_(uint8_t addr, uint8_t ep) {
+  for (auto &stats : this->endpoints_) {
+    if (stats.address == addr && stats.endpoint == ep) {
+      return &stats;
+    }
+  }
+  if (this->endpoints_.size() >= MAX3421E_STATS_MAX_ENDPOINTS) {
+    return nullptr;
+  }
+  USB_TRANSFER_STATS stats{};
+  stats.address = addr;
+  stats.endpoint = ep;
+  this->endpoints_.push_back(stats);
+  return &this->endpoints_.back();
+}
+
+void TransferStats::add_(USB_TRANSFER_STATS *stats, uint8_t rcode, uint32_t bytes, uint32_t latency_us) {
+  stats->transfers++;
+  stats->bytes += bytes;
+  if (rcode == hrNAK) {
+    // no data yet, what every idle interrupt poll ends with
+    stats->naks++;
+  } else if (rcode) {
+    stats->errors++;
+    if (rcode == hrTIMEOUT) {
+      stats->timeouts++;
+    } else if (rcode == hrSTALL) {
+      stats->stalls++;
+    }
+  }
+  stats->latency_total_us += latency_us;
+  if (latency_us > stats->latency_max_us) {
+    stats->latency_max_us = latency_us;
+  }
+  uint8_t bucket = 0;
+  while (bucket + 1 < MAX3421E_STATS_LATENCY_BUCKETS && latency_us >= latency_bucket_limit(bucket)) {
+    bucket++;
+  }
+  stats->latency_hist[bucket]++;
+}
+
+void TransferStats::merge_(USB_TRANSFER_STATS *into, const USB_TRANSFER_STATS &from) {
+  into->transfers += from.transfers;
+  into->errors += from.errors;
+  into->naks += from.naks;
+  into->timeouts += from.timeouts;
+  into->stalls += from.stalls;
+  into->retries += from.retries;
+  into->bytes += from.bytes;
+  into->latency_total_us += from.latency_total_us;
+  if (from.latency_max_us > into->latency_max_us) {
+    into->latency_max_us = from.latency_max_us;
+  }
+  for (uint8_t i = 0; i < MAX3421E_STATS_LATENCY_BUCKETS; i++) {
+    into->latency_hist[i] += from.latency_hist[i];
+  }
+}
+
+}  // namespace max3421e
+}  // namespace esphome
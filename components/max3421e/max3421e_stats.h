@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+
+#include "esphome/core/hal.h"
+
+#include "Usb.h"
+
+// latency histogram buckets, bucket i counts transfers faster than 2^(i + 6)us (64us up to 131ms),
+// the last bucket counts all slower ones.
+#define MAX3421E_STATS_LATENCY_BUCKETS 12
+#define MAX3421E_STATS_LATENCY_MIN_SHIFT 6
+#ifndef MAX3421E_STATS_MAX_ENDPOINTS
+// endpoints tracked individually, transfers of further endpoints only count in the totals.
+#define MAX3421E_STATS_MAX_ENDPOINTS 32
+#endif
+
+namespace esphome {
+namespace max3421e {
+
+// address of the default control endpoint in the statistics.
+static const uint8_t STATS_CONTROL_ENDPOINT = 0x00;
+// direction bit of IN endpoint addresses.
+static const uint8_t STATS_ENDPOINT_IN = 0x80;
+
+typedef struct {
+  uint8_t address;   // device address, 0 for the totals
+  uint8_t endpoint;  // endpoint address with direction bit (e.g. 0x81 for EP1 IN)
+  uint32_t transfers;
+  uint32_t errors;  // failed transfers, including timeouts and stalls but not NAKs
+  uint32_t naks;    // transfers given up after the NAK limit (no data / not ready), not counted as errors
+  uint32_t timeouts;
+  uint32_t stalls;
+  uint32_t retries;  // transfers repeated by the driver after a failure
+  uint32_t bytes;
+  uint32_t latency_max_us;
+  uint64_t latency_total_us;
+  uint32_t latency_hist[MAX3421E_STATS_LATENCY_BUCKETS];
+} USB_TRANSFER_STATS;
+
+// Counters of the transfers done by this component and its class drivers.
+class TransferStats {
+ public:
+  // record a finished transfer with its result code, the bytes moved and its duration.
+  void record(uint8_t addr, uint8_t ep, uint8_t rcode, uint32_t bytes, uint32_t latency_us);
+  // record a transfer from its start time (micros()) until now.
+  void record_since(uint8_t addr, uint8_t ep, uint8_t rcode, uint32_t bytes, uint32_t started_us) {
+    this->record(addr, ep, rcode, bytes, micros() - started_us);
+  }
+  // record a transfer the driver repeats after a failure.
+  void record_retry(uint8_t addr, uint8_t ep);
+  // forget the endpoints of a detached device, the totals are kept.
+  void forget(uint8_t addr);
+
+  const USB_TRANSFER_STATS &total() const { return this->total_; }
+  const std::vector<USB_TRANSFER_STATS> &endpoints() const { return this->endpoints_; }
+  // sums up the endpoints matching the filter, 0 matches any address and 0xFF any endpoint.
+  void sum(uint8_t addr, uint8_t ep, USB_TRANSFER_STATS *out) const;
+
+  // upper bound of the latency the given percentage of transfers stayed below in microseconds.
+  static uint32_t latency_percentile(const USB_TRANSFER_STATS &stats, float percent);
+  // upper bound of a latency histogram bucket in microseconds.
+  static uint32_t latency_bucket_limit(uint8_t bucket) {
+    return bucket + 1 < MAX3421E_STATS_LATENCY_BUCKETS ? 1UL << (bucket + MAX3421E_STATS_LATENCY_MIN_SHIFT)
+                                                      : UINT32_MAX;
+  }
+
+ protected:
+  USB_TRANSFER_STATS *get_(uint8_t addr, uint8_t ep);
+  static void add_(USB_TRANSFER_STATS *stats, uint8_t rcode, uint32_t bytes, uint32_t latency_us);
+  static void merge_(USB_TRANSFER_STATS *into, const USB_TRANSFER_STATS &from);
+
+  USB_TRANSFER_STATS total_{};
+  std::vector<USB_TRANSFER_STATS> endpoints_;
+};
+
+}  // namespace max3421e
+}  // namespace esphome
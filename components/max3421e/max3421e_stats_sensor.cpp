@@ -0,0 +1,130 @@
+#include "max3421e_stats_sensor.h"
+
+#ifdef USE_SENSOR
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace max3421e {
+
+static const char *const TAG = "max3421e.stats";
+
+uint8_t TransferStatsSensor::address_() const {
+  if (this->all_devices_) {
+    return 0;
+  }
+  const USB_DEVICE_ENTRY *device = this->parent_->getPortDevice(this->hub_, this->port_);
+  return device != nullptr ? device->address : 0xFF;
+}
+
+float TransferStatsSensor::ready_time_(bool known) const {
+  if (this->all_devices_) {
+    uint32_t ready_time = this->parent_->getReadyTime(known);
+    return ready_time ? ready_time : NAN;
+  }
+  const USB_DEVICE_ENTRY *device = this->parent_->getPortDevice(this->hub_, this->port_);
+  if (device == nullptr || device->ready_time == 0 || device->known != known) {
+    return NAN;
+  }
+  return device->ready_time;
+}
+
+void TransferStatsSensor::update() {
+  uint8_t addr = this->address_();
+  USB_TRANSFER_STATS stats{};
+  if (addr != 0xFF) {
+    this->parent_->getStats()->sum(addr, this->endpoint_, &stats);
+  }
+
+  if (this->transfers_sensor_ != nullptr) {
+    this->transfers_sensor_->publish_state(stats.transfers);
+  }
+  if (this->errors_sensor_ != nullptr) {
+    this->errors_sensor_->publish_state(stats.errors);
+  }
+  if (this->naks_sensor_ != nullptr) {
+    this->naks_sensor_->publish_state(stats.naks);
+  }
+  if (this->timeouts_sensor_ != nullptr) {
+    this->timeouts_sensor_->publish_state(stats.timeouts);
+  }
+  if (this->retries_sensor_ != nullptr) {
+    this->retries_sensor_->publish_state(stats.retries);
+  }
+  if (this->bytes_sensor_ != nullptr) {
+    this->bytes_sensor_->publish_state(stats.bytes);
+  }
+
+  uint32_t now = millis();
+  if (this->throughput_sensor_ != nullptr) {
+    // the counters of a port restart with every device attached to it
+    if (this->last_update_ != 0 && addr == this->last_address_ && stats.bytes >= this->last_bytes_ &&
+        now != this->last_update_) {
+      this->throughput_sensor_->publish_state((stats.bytes - this->last_bytes_) * 1000.0f /
+                                              (now - this->last_update_));
+    } else if (this->last_update_ != 0) {
+      this->throughput_sensor_->publish_state(NAN);
+    }
+  }
+  this->last_address_ = addr;
+  this->last_bytes_ = stats.bytes;
+  this->last_update_ = now;
+
+  if (this->latency_sensor_ != nullptr) {
+    this->latency_sensor_->publish_state(stats.transfers ? stats.latency_total_us / 1000.0f / stats.transfers : NAN);
+  }
+  if (this->latency_p95_sensor_ != nullptr) {
+    this->latency_p95_sensor_->publish_state(
+        stats.transfers ? TransferStats::latency_percentile(stats, 95.0f) / 1000.0f : NAN);
+  }
+  if (this->latency_max_sensor_ != nullptr) {
+    this->latency_max_sensor_->publish_state(stats.transfers ? stats.latency_max_us / 1000.0f : NAN);
+  }
+  if (this->deadline_misses_sensor_ != nullptr) {
+    this->deadline_misses_sensor_->publish_state(
+        addr != 0xFF ? this->parent_->getScheduler()->misses(addr, this->endpoint_) : 0);
+  }
+  if (this->suspended_time_sensor_ != nullptr) {
+    this->suspended_time_sensor_->publish_state(this->parent_->getSuspendedTime() / 1000);
+  }
+  if (this->ready_time_known_sensor_ != nullptr) {
+    this->ready_time_known_sensor_->publish_state(this->ready_time_(true));
+  }
+  if (this->ready_time_new_sensor_ != nullptr) {
+    this->ready_time_new_sensor_->publish_state(this->ready_time_(false));
+  }
+}
+
+void TransferStatsSensor::dump_config() {
+  ESP_LOGCONFIG(TAG, "MAX3421E Transfer Statistics:");
+  if (this->all_devices_) {
+    ESP_LOGCONFIG(TAG, "  Devices: all");
+  } else {
+    ESP_LOGCONFIG(TAG, "  Device: hub %d port %d", this->hub_, this->port_);
+  }
+  if (this->endpoint_ == 0xFF) {
+    ESP_LOGCONFIG(TAG, "  Endpoint: all");
+  } else {
+    ESP_LOGCONFIG(TAG, "  Endpoint: 0x%02X", this->endpoint_);
+  }
+  LOG_UPDATE_INTERVAL(this);
+  LOG_SENSOR("  ", "Transfers", this->transfers_sensor_);
+  LOG_SENSOR("  ", "Errors", this->errors_sensor_);
+  LOG_SENSOR("  ", "NAKs", this->naks_sensor_);
+  LOG_SENSOR("  ", "Timeouts", this->timeouts_sensor_);
+  LOG_SENSOR("  ", "Retries", this->retries_sensor_);
+  LOG_SENSOR("  ", "Bytes", this->bytes_sensor_);
+  LOG_SENSOR("  ", "Throughput", this->throughput_sensor_);
+  LOG_SENSOR("  ", "Latency", this->latency_sensor_);
+  LOG_SENSOR("  ", "Latency P95", this->latency_p95_sensor_);
+  LOG_SENSOR("  ", "Latency Max", this->latency_max_sensor_);
+  LOG_SENSOR("  ", "Deadline Misses", this->deadline_misses_sensor_);
+  LOG_SENSOR("  ", "Suspended Time", this->suspended_time_sensor_);
+  LOG_SENSOR("  ", "Ready Time Known", this->ready_time_known_sensor_);
+  LOG_SENSOR("  ", "Ready Time New", this->ready_time_new_sensor_);
+}
+
+}  // namespace max3421e
+}  // namespace esphome
+
+#endif  // USE_SENSOR
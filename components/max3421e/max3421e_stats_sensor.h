@@ -0,0 +1,81 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_SENSOR
+
+#include "esphome/core/component.h"
+#include "esphome/components/sensor/sensor.h"
+
+#include "max3421e.h"
+
+namespace esphome {
+namespace max3421e {
+
+// Publishes the transfer statistics of all devices, the device on a port or one of its endpoints.
+class TransferStatsSensor : public PollingComponent {
+ public:
+  void update() override;
+  void dump_config() override;
+  float get_setup_priority() const override { return setup_priority::DATA; }
+
+  void set_parent(MAX3421EComponent *parent) { this->parent_ = parent; }
+  // only count the device on the given port of a hub, otherwise all devices are counted.
+  void set_port(uint8_t hub, uint8_t port) {
+    this->all_devices_ = false;
+    this->hub_ = hub;
+    this->port_ = port;
+  }
+  void set_endpoint(uint8_t endpoint) { this->endpoint_ = endpoint; }
+
+  void set_transfers_sensor(sensor::Sensor *sensor) { this->transfers_sensor_ = sensor; }
+  void set_errors_sensor(sensor::Sensor *sensor) { this->errors_sensor_ = sensor; }
+  void set_naks_sensor(sensor::Sensor *sensor) { this->naks_sensor_ = sensor; }
+  void set_timeouts_sensor(sensor::Sensor *sensor) { this->timeouts_sensor_ = sensor; }
+  void set_retries_sensor(sensor::Sensor *sensor) { this->retries_sensor_ = sensor; }
+  void set_bytes_sensor(sensor::Sensor *sensor) { this->bytes_sensor_ = sensor; }
+  void set_throughput_sensor(sensor::Sensor *sensor) { this->throughput_sensor_ = sensor; }
+  void set_latency_sensor(sensor::Sensor *sensor) { this->latency_sensor_ = sensor; }
+  void set_latency_p95_sensor(sensor::Sensor *sensor) { this->latency_p95_sensor_ = sensor; }
+  void set_latency_max_sensor(sensor::Sensor *sensor) { this->latency_max_sensor_ = sensor; }
+  void set_deadline_misses_sensor(sensor::Sensor *sensor) { this->deadline_misses_sensor_ = sensor; }
+  void set_suspended_time_sensor(sensor::Sensor *sensor) { this->suspended_time_sensor_ = sensor; }
+  void set_ready_time_known_sensor(sensor::Sensor *sensor) { this->ready_time_known_sensor_ = sensor; }
+  void set_ready_time_new_sensor(sensor::Sensor *sensor) { this->ready_time_new_sensor_ = sensor; }
+
+ protected:
+  // address of the selected device, 0 for all devices and 0xFF if no device is attached to the port.
+  uint8_t address_() const;
+  // ready time of the last selected device taken from the device cache (known) or read completely, NAN if none.
+  float ready_time_(bool known) const;
+
+  MAX3421EComponent *parent_;
+  bool all_devices_{true};
+  uint8_t hub_{0};
+  uint8_t port_{0};
+  uint8_t endpoint_{0xFF};
+  // address and counters of the previous update for the throughput
+  uint8_t last_address_{0};
+  uint32_t last_bytes_{0};
+  uint32_t last_update_{0};
+
+  sensor::Sensor *transfers_sensor_{nullptr};
+  sensor::Sensor *errors_sensor_{nullptr};
+  sensor::Sensor *naks_sensor_{nullptr};
+  sensor::Sensor *timeouts_sensor_{nullptr};
+  sensor::Sensor *retries_sensor_{nullptr};
+  sensor::Sensor *bytes_sensor_{nullptr};
+  sensor::Sensor *throughput_sensor_{nullptr};
+  sensor::Sensor *latency_sensor_{nullptr};
+  sensor::Sensor *latency_p95_sensor_{nullptr};
+  sensor::Sensor *latency_max_sensor_{nullptr};
+  sensor::Sensor *deadline_misses_sensor_{nullptr};
+  sensor::Sensor *suspended_time_sensor_{nullptr};
+  sensor::Sensor *ready_time_known_sensor_{nullptr};
+  sensor::Sensor *ready_time_new_sensor_{nullptr};
+};
+
+}  // namespace max3421e
+}  // namespace esphome
+
+#endif  // USE_SENSOR
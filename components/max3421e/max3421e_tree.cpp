@@ -0,0 +1,167 @@
+#include "max3421e.h"
+
+#ifdef USE_JSON
+#include "esphome/components/json/json_util.h"
+#endif
+
+namespace esphome {
+namespace max3421e {
+
+std::string MAX3421EComponent::deviceTreeJson() {
+#ifdef USE_JSON
+  return json::build_json([this](JsonObject root) {
+    JsonArray devices = root.createNestedArray("devices");
+    for (auto &entry : this->devices_) {
+      if (entry.address == 0) {
+        continue;
+      }
+      JsonObject dev = devices.createNestedObject();
+      dev["address"] = entry.address;
+      dev["hub"] = entry.hub;
+      dev["port"] = entry.port;
+      dev["is_hub"] = entry.is_hub;
+      if (entry.info_state < DEVICE_INFO_READ) {
+        dev["pending"] = true;
+        continue;
+      }
+      dev["usb"] = entry.devDesc.bcdUSB;
+      dev["class"] = entry.devDesc.bDeviceClass;
+      dev["subclass"] = entry.devDesc.bDeviceSubClass;
+      dev["protocol"] = entry.devDesc.bDeviceProtocol;
+      dev["vid"] = entry.devDesc.idVendor;
+      dev["pid"] = entry.devDesc.idProduct;
+      dev["release"] = entry.devDesc.bcdDevice;
+      dev["manufacturer"] = entry.manufacturer;
+      dev["product"] = entry.product;
+      dev["serial"] = entry.serial;
+      JsonArray confs = dev.createNestedArray("configurations");
+      JsonArray intfs;
+      JsonArray eps;
+      for (const DescriptorView &desc : DescriptorRange(entry.conf)) {
+        if (const auto *cd = desc.as<USB_CONFIGURATION_DESCRIPTOR>()) {
+          JsonObject c = confs.createNestedObject();
+          c["value"] = cd->bConfigurationValue;
+          c["attributes"] = cd->bmAttributes;
+          c["max_power"] = cd->bMaxPower;
+          intfs = c.createNestedArray("interfaces");
+          eps = JsonArray();
+        } else if (const auto *id = desc.as<USB_INTERFACE_DESCRIPTOR>()) {
+          if (intfs.isNull()) {
+            continue;
+          }
+          JsonObject i = intfs.createNestedObject();
+          i["number"] = id->bInterfaceNumber;
+          i["alternate"] = id->bAlternateSetting;
+          i["class"] = id->bInterfaceClass;
+          i["subclass"] = id->bInterfaceSubClass;
+          i["protocol"] = id->bInterfaceProtocol;
+          eps = i.createNestedArray("endpoints");
+        } else if (const auto *ed = desc.as<USB_ENDPOINT_DESCRIPTOR>()) {
+          if (eps.isNull()) {
+            continue;
+          }
+          JsonObject e = eps.createNestedObject();
+          e["address"] = ed->bEndpointAddress;
+          e["attributes"] = ed->bmAttributes;
+          e["max_packet_size"] = ed->wMaxPacketSize;
+          e["interval"] = ed->bInterval;
+        }
+      }
+    }
+  });
+#else
+  return "";
+#endif
+}
+
+// Binary format (little endian):
+//   header:  'U' 'T' version device_count
+//   device:  address hub port flags(bit 0: hub, bit 1: infos read)
+//            device descriptor (18 bytes)
+//            manufacturer, product, serial: length (1 byte) + characters
+//            configuration summary: length (2 bytes) + configuration, interface and endpoint descriptors
+// Devices still waiting for their infos end after the flags.
+std::vector<uint8_t> MAX3421EComponent::deviceTreeBinary() {
+  std::vector<uint8_t> out = {'U', 'T', DEVICE_TREE_BINARY_VERSION, 0};
+  auto append_str = [&out](const std::string &str) {
+    uint8_t len = std::min(str.size(), (size_t) 0xFF);
+    out.push_back(len);
+    out.insert(out.end(), str.begin(), str.begin() + len);
+  };
+  for (auto &entry : this->devices_) {
+    if (entry.address == 0) {
+      continue;
+    }
+    out[3]++;
+    bool read = entry.info_state >= DEVICE_INFO_READ;
+    out.push_back(entry.address);
+    out.push_back(entry.hub);
+    out.push_back(entry.port);
+    out.push_back((entry.is_hub ? 0x01 : 0x00) | (read ? 0x02 : 0x00));
+    if (!read) {
+      continue;
+    }
+    const uint8_t *dev_desc = (const uint8_t *) &entry.devDesc;
+    out.insert(out.end(), dev_desc, dev_desc + sizeof(USB_DEVICE_DESCRIPTOR));
+    append_str(entry.manufacturer);
+    append_str(entry.product);
+    append_str(entry.serial);
+    out.push_back(entry.conf.size() & 0xFF);
+    out.push_back(entry.conf.size() >> 8);
+    out.insert(out.end(), entry.conf.begin(), entry.conf.end());
+  }
+  return out;
+}
+
+std::string MAX3421EComponent::deviceTree() {
+  if (this->device_tree_format_ == DEVICE_TREE_FORMAT_BINARY) {
+    return base64_encode(this->deviceTreeBinary());
+  }
+  return this->deviceTreeJson();
+}
+
+std::string MAX3421EComponent::deviceTreeSummary() {
+  std::vector<std::string> items;
+  for (auto &entry : this->devices_) {
+    if (entry.address == 0) {
+      continue;
+    }
+    if (entry.info_state < DEVICE_INFO_READ) {
+      items.push_back(str_sprintf("%u.%u pending", entry.hub, entry.port));
+    } else {
+      items.push_back(str_sprintf("%u.%u %04X:%04X%s", entry.hub, entry.port, entry.devDesc.idVendor,
+                                  entry.devDesc.idProduct, entry.is_hub ? " hub" : ""));
+    }
+  }
+  std::string summary = str_sprintf("%u devices", (unsigned) items.size());
+  for (size_t i = 0; i < items.size(); i++) {
+    std::string more = str_sprintf(", +%u more", (unsigned) (items.size() - i));
+    // keep room to say how many devices didn't fit
+    size_t room = i + 1 < items.size() ? more.size() : 0;
+    if (summary.size() + 2 + items[i].size() + room > MAX3421E_DEVICE_TREE_STATE_LEN) {
+      summary += more;
+      break;
+    }
+    summary += (i == 0 ? ": " : ", ") + items[i];
+  }
+  return summary;
+}
+
+void MAX3421EComponent::publishDeviceTree() {
+  this->device_tree_dirty_ = false;
+  std::string tree = this->deviceTree();
+  size_t chunks = (tree.size() + MAX3421E_DEVICE_TREE_LOG_CHUNK - 1) / MAX3421E_DEVICE_TREE_LOG_CHUNK;
+  for (size_t i = 0; i < chunks; i++) {
+    ESP_LOGI(TAG, "Device tree %u/%u: %s", (unsigned) (i + 1), (unsigned) chunks,
+             tree.substr(i * MAX3421E_DEVICE_TREE_LOG_CHUNK, MAX3421E_DEVICE_TREE_LOG_CHUNK).c_str());
+  }
+  this->device_tree_callback_.call(tree);
+#ifdef USE_TEXT_SENSOR
+  if (this->device_tree_sensor_ != nullptr) {
+    this->device_tree_sensor_->publish_state(this->deviceTreeSummary());
+  }
+#endif
+}
+
+}  // namespace max3421e
+}  // namespace esphome
@@ -0,0 +1,39 @@
+#pragma once
+
+// Force included into every translation unit (including the USB library) with the esp_idf SPI backend,
+// where USB_SPI is defined to esphome::max3421e::usb_spi. Keep it free of esphome includes.
+#ifdef __cplusplus
+
+#include <SPI.h>
+
+namespace esphome {
+namespace max3421e {
+
+class SPIBackend;
+
+// Stands in for the Arduino SPIClass used by the USB library and forwards its calls to a SPI backend.
+class USBSPI {
+ public:
+  void set_backend(SPIBackend *backend) { this->backend_ = backend; }
+
+  // the backend is set up by the component before the USB library initializes the chip
+  void begin() {}
+  void end() {}
+  // the clock of the backend is used, the library always asks for the maximum of the chip
+  void beginTransaction(SPISettings settings);
+  void endTransaction();
+  uint8_t transfer(uint8_t data);
+  void transfer(void *data, uint32_t size);
+  void writeBytes(const uint8_t *data, uint32_t size);
+  void transferBytes(const uint8_t *data, uint8_t *out, uint32_t size);
+
+ protected:
+  SPIBackend *backend_{nullptr};
+};
+
+extern USBSPI usb_spi;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+}  // namespace max3421e
+}  // namespace esphome
+
+#endif  // __cplusplus
@@ -0,0 +1,131 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    CONF_ID,
+    CONF_PORT,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_BYTES,
+    UNIT_MILLISECOND,
+    UNIT_SECOND,
+)
+
+from . import CONF_MAX3421E_ID, CONF_HUB, PORT_SCHEMA, MAX3421EComponent, max3421e_ns
+
+DEPENDENCIES = ["max3421e", "sensor"]
+
+CONF_ENDPOINT = "endpoint"
+CONF_TRANSFERS = "transfers"
+CONF_ERRORS = "errors"
+CONF_NAKS = "naks"
+CONF_TIMEOUTS = "timeouts"
+CONF_RETRIES = "retries"
+CONF_BYTES = "bytes"
+CONF_THROUGHPUT = "throughput"
+CONF_LATENCY = "latency"
+CONF_LATENCY_P95 = "latency_p95"
+CONF_LATENCY_MAX = "latency_max"
+CONF_DEADLINE_MISSES = "deadline_misses"
+CONF_SUSPENDED_TIME = "suspended_time"
+CONF_READY_TIME_KNOWN = "ready_time_known"
+CONF_READY_TIME_NEW = "ready_time_new"
+
+UNIT_BYTES_PER_SECOND = "B/s"
+
+TransferStatsSensor = max3421e_ns.class_("TransferStatsSensor", cg.PollingComponent)
+
+
+def _counter_schema(icon):
+    return sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon=icon,
+    )
+
+
+def _ready_time_schema():
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:timer-check-outline",
+    )
+
+
+def _latency_schema():
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        accuracy_decimals=2,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:timer-outline",
+    )
+
+
+COUNTERS = {
+    CONF_TRANSFERS: "mdi:swap-horizontal",
+    CONF_ERRORS: "mdi:alert-circle-outline",
+    CONF_NAKS: "mdi:cancel",
+    CONF_TIMEOUTS: "mdi:timer-sand-empty",
+    CONF_RETRIES: "mdi:replay",
+    # interrupt endpoints polled later than one bInterval after they were due
+    CONF_DEADLINE_MISSES: "mdi:calendar-clock",
+}
+
+CONFIG_SCHEMA = cv.Schema({
+    cv.GenerateID(): cv.declare_id(TransferStatsSensor),
+    cv.GenerateID(CONF_MAX3421E_ID): cv.use_id(MAX3421EComponent),
+    # endpoint address with direction bit, e.g. 0x81 for EP1 IN, 0 for the control endpoint.
+    cv.Optional(CONF_ENDPOINT): cv.hex_int_range(0, 0x8F),  # type: ignore[arg-type]
+    **{cv.Optional(key): _counter_schema(icon) for key, icon in COUNTERS.items()},
+    cv.Optional(CONF_BYTES): sensor.sensor_schema(
+        unit_of_measurement=UNIT_BYTES,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:database-arrow-right",
+    ),
+    cv.Optional(CONF_THROUGHPUT): sensor.sensor_schema(
+        unit_of_measurement=UNIT_BYTES_PER_SECOND,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:speedometer",
+    ),
+    cv.Optional(CONF_LATENCY): _latency_schema(),
+    cv.Optional(CONF_LATENCY_P95): _latency_schema(),
+    cv.Optional(CONF_LATENCY_MAX): _latency_schema(),
+    # total time the bus was suspended, independent of hub, port and endpoint
+    cv.Optional(CONF_SUSPENDED_TIME): sensor.sensor_schema(
+        unit_of_measurement=UNIT_SECOND,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:power-sleep",
+    ),
+    # time from being found until the infos of the last device were read, taken from the device cache or not
+    cv.Optional(CONF_READY_TIME_KNOWN): _ready_time_schema(),
+    cv.Optional(CONF_READY_TIME_NEW): _ready_time_schema(),
+}).extend(PORT_SCHEMA).extend(cv.polling_component_schema("60s"))
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+    component = await cg.get_variable(config[CONF_MAX3421E_ID])
+    cg.add(var.set_parent(component))
+
+    if CONF_PORT in config:
+        cg.add(var.set_port(config[CONF_HUB], config[CONF_PORT]))
+    if CONF_ENDPOINT in config:
+        cg.add(var.set_endpoint(config[CONF_ENDPOINT]))
+
+    for key in [*COUNTERS, CONF_BYTES, CONF_THROUGHPUT, CONF_LATENCY, CONF_LATENCY_P95, CONF_LATENCY_MAX,
+                CONF_SUSPENDED_TIME, CONF_READY_TIME_KNOWN, CONF_READY_TIME_NEW]:
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(var, f"set_{key}_sensor")(sens))
@@ -1,13 +1,14 @@
 from esphome.components import text_sensor
 import esphome.config_validation as cv
 import esphome.codegen as cg
-from esphome.const import ENTITY_CATEGORY_DIAGNOSTIC
+from esphome.const import CONF_PORT, ENTITY_CATEGORY_DIAGNOSTIC
 
-from . import CONF_MAX3421E_ID, MAX3421EComponent
+from . import CONF_MAX3421E_ID, CONF_HUB, PORT_SCHEMA, MAX3421EComponent
 
 DEPENDENCIES = ["max3421e", "text_sensor"]
 
 CONF_DEVICE_INFO = "device_info"
+CONF_DEVICE_TREE = "device_tree"
 
 CONFIG_SCHEMA = cv.Schema({
     cv.GenerateID(CONF_MAX3421E_ID): cv.use_id(MAX3421EComponent),
@@ -15,7 +16,13 @@ CONFIG_SCHEMA = cv.Schema({
         entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         icon="mdi:usb",
     ),
-})
+    # summary of all devices (hub.port VID:PID), published once after attached devices are read. The whole tree
+    # exceeds the 255 characters of a state, it is logged and passed to on_device_tree.
+    cv.Optional(CONF_DEVICE_TREE): text_sensor.text_sensor_schema(
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:file-tree",
+    ),
+}).extend(PORT_SCHEMA)
 
 
 async def to_code(config):
@@ -23,4 +30,11 @@ async def to_code(config):
 
     if CONF_DEVICE_INFO in config:
         var = await text_sensor.new_text_sensor(config[CONF_DEVICE_INFO])
-        cg.add(component.set_device_info_sensor(var))
+        if CONF_PORT in config:
+            cg.add(component.add_port_info_sensor(config[CONF_HUB], config[CONF_PORT], var))
+        else:
+            cg.add(component.set_device_info_sensor(var))
+
+    if CONF_DEVICE_TREE in config:
+        var = await text_sensor.new_text_sensor(config[CONF_DEVICE_TREE])
+        cg.add(component.set_device_tree_sensor(var))
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Decode the binary device tree of the max3421e device_tree text sensor (format: binary).
+
+Usage: decode_device_tree.py [BASE64]   (reads stdin without argument)
+
+Prints the same JSON as the device_tree text sensor with format: json.
+"""
+import base64
+import json
+import struct
+import sys
+
+VERSION = 1
+
+DESCRIPTOR_CONFIGURATION = 0x02
+DESCRIPTOR_INTERFACE = 0x04
+DESCRIPTOR_ENDPOINT = 0x05
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise ValueError(f"truncated at byte {self.pos}, {n} more bytes expected")
+        chunk = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+    def u8(self):
+        return self.take(1)[0]
+
+    def u16(self):
+        return struct.unpack("<H", self.take(2))[0]
+
+    def string(self):
+        return self.take(self.u8()).decode("latin-1")
+
+
+def decode_configurations(conf):
+    confs = []
+    intfs = None
+    eps = None
+    pos = 0
+    while pos + 2 <= len(conf) and conf[pos] >= 2 and pos + conf[pos] <= len(conf):
+        desc = conf[pos:pos + conf[pos]]
+        pos += conf[pos]
+        if desc[1] == DESCRIPTOR_CONFIGURATION and len(desc) >= 9:
+            _, _, _, _, value, _, attributes, max_power = struct.unpack("<BBHBBBBB", desc[:9])
+            intfs = []
+            eps = None
+            confs.append({"value": value, "attributes": attributes, "max_power": max_power, "interfaces": intfs})
+        elif desc[1] == DESCRIPTOR_INTERFACE and len(desc) >= 9 and intfs is not None:
+            _, _, number, alternate, _, cls, subclass, protocol, _ = struct.unpack("<BBBBBBBBB", desc[:9])
+            eps = []
+            intfs.append({"number": number, "alternate": alternate, "class": cls, "subclass": subclass,
+                          "protocol": protocol, "endpoints": eps})
+        elif desc[1] == DESCRIPTOR_ENDPOINT and len(desc) >= 7 and eps is not None:
+            _, _, address, attributes, max_packet_size, interval = struct.unpack("<BBBBHB", desc[:7])
+            eps.append({"address": address, "attributes": attributes, "max_packet_size": max_packet_size,
+                        "interval": interval})
+    return confs
+
+
+def decode(data):
+    r = Reader(data)
+    if r.take(2) != b"UT":
+        raise ValueError("not a device tree")
+    version = r.u8()
+    if version != VERSION:
+        raise ValueError(f"unsupported version {version}")
+    devices = []
+    for _ in range(r.u8()):
+        address, hub, port, flags = r.u8(), r.u8(), r.u8(), r.u8()
+        dev = {"address": address, "hub": hub, "port": port, "is_hub": bool(flags & 0x01)}
+        devices.append(dev)
+        if not flags & 0x02:
+            dev["pending"] = True
+            continue
+        (_, _, usb, cls, subclass, protocol, _, vid, pid, release, _, _, _, _) = struct.unpack(
+            "<BBHBBBBHHHBBBB", r.take(18))
+        dev.update({"usb": usb, "class": cls, "subclass": subclass, "protocol": protocol, "vid": vid, "pid": pid,
+                    "release": release, "manufacturer": r.string(), "product": r.string(), "serial": r.string()})
+        dev["configurations"] = decode_configurations(r.take(r.u16()))
+    return {"devices": devices}
+
+
+def main():
+    text = sys.argv[1] if len(sys.argv) > 1 else sys.stdin.read()
+    print(json.dumps(decode(base64.b64decode(text.strip())), indent=2))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,66 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import uart
+from esphome.components.max3421e import CONF_MAX3421E_ID, MAX3421EComponent
+from esphome.const import (
+    CONF_ID,
+    CONF_BAUD_RATE,
+    CONF_DATA_BITS,
+    CONF_PARITY,
+    CONF_RX_BUFFER_SIZE,
+    CONF_RX_PIN,
+    CONF_STOP_BITS,
+    CONF_TX_PIN,
+)
+
+DEPENDENCIES = ["max3421e"]
+AUTO_LOAD = ["uart"]
+
+CONF_TX_BUFFER_SIZE = "tx_buffer_size"
+CONF_BENCHMARK_INTERVAL = "benchmark_interval"
+
+max3421e_cdc_acm_ns = cg.esphome_ns.namespace("max3421e_cdc_acm")
+CDCACMComponent = max3421e_cdc_acm_ns.class_(
+    "CDCACMComponent", uart.UARTComponent, cg.Component
+)
+
+
+def _usb_pins(config):
+    # the usb endpoints take the place of the pins. uart devices validate that the
+    # pins they need are configured on their bus, so mark both as present.
+    config[CONF_TX_PIN] = "USB"
+    config[CONF_RX_PIN] = "USB"
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
+    cv.Schema({
+        cv.GenerateID(): cv.declare_id(CDCACMComponent),
+        cv.GenerateID(CONF_MAX3421E_ID): cv.use_id(MAX3421EComponent),
+        cv.Optional(CONF_BAUD_RATE, default=115200): cv.int_range(min=1),  # type: ignore[arg-type]
+        cv.Optional(CONF_DATA_BITS, default=8): cv.int_range(min=5, max=8),  # type: ignore[arg-type]
+        cv.Optional(CONF_PARITY, default="NONE"): cv.enum(uart.UART_PARITY_OPTIONS, upper=True),  # type: ignore[arg-type]
+        cv.Optional(CONF_STOP_BITS, default=1): cv.one_of(1, 2, int=True),  # type: ignore[arg-type]
+        cv.Optional(CONF_RX_BUFFER_SIZE, default=1024): cv.validate_bytes,  # type: ignore[arg-type]
+        cv.Optional(CONF_TX_BUFFER_SIZE, default=1024): cv.validate_bytes,  # type: ignore[arg-type]
+        # log the sustained throughput in this interval, 0s disables it.
+        cv.Optional(CONF_BENCHMARK_INTERVAL, default="0s"): cv.time_period,  # type: ignore[arg-type]
+    }).extend(cv.COMPONENT_SCHEMA),
+    _usb_pins,
+)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    parent = await cg.get_variable(config[CONF_MAX3421E_ID])
+    cg.add(var.set_parent(parent))
+
+    cg.add(var.set_baud_rate(config[CONF_BAUD_RATE]))
+    cg.add(var.set_data_bits(config[CONF_DATA_BITS]))
+    cg.add(var.set_parity(config[CONF_PARITY]))
+    cg.add(var.set_stop_bits(config[CONF_STOP_BITS]))
+    cg.add(var.set_rx_buffer_size(config[CONF_RX_BUFFER_SIZE]))
+    cg.add(var.set_tx_buffer_size(config[CONF_TX_BUFFER_SIZE]))
+    cg.add(var.set_benchmark_interval(config[CONF_BENCHMARK_INTERVAL].total_milliseconds))
@@ -0,0 +1,232 @@
+#include "max3421e_cdc_acm.h"
+
+#include "esphome/core/application.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace max3421e_cdc_acm {
+
+static const char *const TAG = "max3421e_cdc_acm";
+
+// how long blocking uart calls wait for the device.
+static const uint32_t TIMEOUT_MS = 100;
+
+uint8_t StatsACM::receive(uint16_t *bytes_rcvd, uint8_t *dataptr) {
+  // the driver releases the device on errors, so keep what identifies the endpoint
+  uint8_t addr = this->bAddress;
+  uint8_t ep = this->in_endpoint();
+  uint32_t start = micros();
+  uint8_t rcode = ACM::RcvData(bytes_rcvd, dataptr);
+  this->parent_->getStats()->record_since(addr, ep, rcode, *bytes_rcvd, start);
+  return rcode;
+}
+
+uint8_t StatsACM::send(uint16_t nbytes, uint8_t *dataptr) {
+  uint8_t addr = this->bAddress;
+  uint8_t ep = this->epInfo[epDataOutIndex].epAddr;
+  uint32_t start = micros();
+  uint8_t rcode = ACM::SndData(nbytes, dataptr);
+  this->parent_->getStats()->record_since(addr, ep, rcode, rcode ? 0 : nbytes, start);
+  return rcode;
+}
+
+void CDCACMComponent::setup() {
+  ESP_LOGCONFIG(TAG, "Setting up MAX3421E CDC-ACM...");
+  this->rx_buffer_.init(this->rx_buffer_size_);
+  this->tx_buffer_.init(this->tx_buffer_size_);
+  // registers itself as device class at the USB host
+  this->acm_ = new StatsACM(this->parent_, this);  // NOLINT(cppcoreguidelines-owning-memory)
+  this->benchmark_last_ = millis();
+}
+
+void CDCACMComponent::dump_config() {
+  ESP_LOGCONFIG(TAG, "MAX3421E CDC-ACM:");
+  ESP_LOGCONFIG(TAG, "  Baud Rate:          %u baud", this->baud_rate_);
+  ESP_LOGCONFIG(TAG, "  Data Bits:          %u", this->data_bits_);
+  ESP_LOGCONFIG(TAG, "  Parity:             %s", LOG_STR_ARG(uart::parity_to_str(this->parity_)));
+  ESP_LOGCONFIG(TAG, "  Stop bits:          %u", this->stop_bits_);
+  ESP_LOGCONFIG(TAG, "  RX Buffer Size:     %u", this->rx_buffer_.capacity());
+  ESP_LOGCONFIG(TAG, "  TX Buffer Size:     %u", this->tx_buffer_.capacity());
+  ESP_LOGCONFIG(TAG, "  Benchmark Interval: %us", this->benchmark_interval_ / 1000);
+}
+
+float CDCACMComponent::get_setup_priority() const { return setup_priority::BUS; }
+
+uint8_t CDCACMComponent::OnInit(ACM *pacm) {
+  uint8_t rcode = pacm->SetControlLineState(0x03);  // DTR and RTS
+  if (rcode) {
+    ESP_LOGE(TAG, "Setting control line state failed. Error code: 0x%02X", rcode);
+    return rcode;
+  }
+  LINE_CODING lc;
+  lc.dwDTERate = this->baud_rate_;
+  lc.bCharFormat = this->stop_bits_ == 2 ? 2 : 0;
+  switch (this->parity_) {
+    case uart::UART_CONFIG_PARITY_ODD:
+      lc.bParityType = 1;
+      break;
+    case uart::UART_CONFIG_PARITY_EVEN:
+      lc.bParityType = 2;
+      break;
+    default:
+      lc.bParityType = 0;
+      break;
+  }
+  lc.bDataBits = this->data_bits_;
+  rcode = pacm->SetLineCoding(&lc);
+  if (rcode) {
+    ESP_LOGE(TAG, "Setting line coding failed. Error code: 0x%02X", rcode);
+    return rcode;
+  }
+  // data of a previous device is of no use anymore
+  this->rx_buffer_.clear();
+  this->tx_buffer_.clear();
+  // polled every frame while data arrives, less often while the device is idle
+  this->parent_->getScheduler()->add(pacm->GetAddress(), this->acm_->in_endpoint(), max3421e::ENDPOINT_BULK, 1,
+                                     [this]() { return this->is_ready() ? this->receive_(micros()) : hrNAK; });
+  ESP_LOGD(TAG, "CDC-ACM device 0x%02X ready", pacm->GetAddress());
+  return 0;
+}
+
+void CDCACMComponent::loop() {
+  if (!this->tx_buffer_.empty()) {
+    this->parent_->requestResume();
+  }
+  if (this->is_ready()) {
+    uint32_t started = micros();
+    // receiving is scheduled by the MAX3421E with the other IN endpoints
+    this->transmit_(started);
+    this->busy_us_ += micros() - started;
+  }
+  if (this->benchmark_interval_ > 0 && millis() - this->benchmark_last_ >= this->benchmark_interval_) {
+    this->report_benchmark_();
+  }
+}
+
+uint8_t CDCACMComponent::receive_(uint32_t started) {
+  uint32_t start = micros();
+  uint8_t result = hrNAK;
+  do {
+    size_t len;
+    uint8_t *dest = this->rx_buffer_.write_region(&len);
+    len = std::min(len, (size_t) MAX3421E_CDC_ACM_MAX_TRANSFER_SIZE);
+    // a transfer must not end in the middle of a packet, the rest of it would be lost.
+    len -= len % MAX3421E_CDC_ACM_PACKET_SIZE;
+    if (len == 0) {
+      if (this->rx_buffer_.space() < MAX3421E_CDC_ACM_PACKET_SIZE) {
+        // leave the data on the device until there is room for it
+        this->rx_stalled_++;
+        break;
+      }
+      dest = this->bounce_;
+      len = MAX3421E_CDC_ACM_PACKET_SIZE;
+    }
+    uint16_t received = len;
+    uint8_t rcode = this->acm_->receive(&received, dest);
+    if (received > 0) {
+      if (dest == this->bounce_) {
+        this->rx_buffer_.push(this->bounce_, received);
+      } else {
+        this->rx_buffer_.commit(received);
+      }
+      this->rx_bytes_ += received;
+      this->rx_transfers_++;
+      result = 0;
+    }
+    if (rcode) {
+      if (rcode != hrNAK) {
+        ESP_LOGW(TAG, "Receiving failed. Error code: 0x%02X", rcode);
+        result = rcode;
+      }
+      break;
+    }
+    if (received < len) {
+      // short packet, the device has no more data right now
+      break;
+    }
+  } while (micros() - started < MAX3421E_CDC_ACM_LOOP_BUDGET_US);
+  this->busy_us_ += micros() - start;
+  return result;
+}
+
+void CDCACMComponent::transmit_(uint32_t started) {
+  while (!this->tx_buffer_.empty() && micros() - started < MAX3421E_CDC_ACM_LOOP_BUDGET_US) {
+    size_t len;
+    uint8_t *data = this->tx_buffer_.read_region(&len);
+    len = std::min(len, (size_t) MAX3421E_CDC_ACM_MAX_TRANSFER_SIZE);
+    uint8_t rcode = this->acm_->send(len, data);
+    if (rcode) {
+      if (rcode != hrNAK) {
+        ESP_LOGW(TAG, "Sending failed. Error code: 0x%02X", rcode);
+      }
+      return;
+    }
+    this->tx_buffer_.consume(len);
+    this->tx_bytes_ += len;
+    this->tx_transfers_++;
+  }
+}
+
+void CDCACMComponent::report_benchmark_() {
+  uint32_t now = millis();
+  float elapsed = (now - this->benchmark_last_) / 1000.0f;
+  ESP_LOGI(TAG, "RX: %.1f kB/s (%u transfers), TX: %.1f kB/s (%u transfers), busy: %.1f%%, RX buffer full: %u loops",
+           this->rx_bytes_ / elapsed / 1000.0f, this->rx_transfers_, this->tx_bytes_ / elapsed / 1000.0f,
+           this->tx_transfers_, this->busy_us_ / elapsed / 10000.0f, this->rx_stalled_);
+  this->benchmark_last_ = now;
+  this->rx_bytes_ = 0;
+  this->tx_bytes_ = 0;
+  this->rx_transfers_ = 0;
+  this->tx_transfers_ = 0;
+  this->rx_stalled_ = 0;
+  this->busy_us_ = 0;
+}
+
+void CDCACMComponent::write_array(const uint8_t *data, size_t len) {
+  // sent once the bus is resumed
+  this->parent_->requestResume();
+  size_t done = this->tx_buffer_.push(data, len);
+  uint32_t start = millis();
+  while (done < len && this->is_ready() && millis() - start < TIMEOUT_MS) {
+    // buffer full, make room by sending right away
+    this->transmit_(micros());
+    done += this->tx_buffer_.push(data + done, len - done);
+    App.feed_wdt();
+  }
+  if (done < len) {
+    ESP_LOGW(TAG, "TX buffer full, dropped %u bytes", len - done);
+  }
+}
+
+bool CDCACMComponent::peek_byte(uint8_t *data) {
+  if (this->rx_buffer_.empty() && this->is_ready()) {
+    this->receive_(micros());
+  }
+  return this->rx_buffer_.peek(data);
+}
+
+bool CDCACMComponent::read_array(uint8_t *data, size_t len) {
+  uint32_t start = millis();
+  while (this->rx_buffer_.size() < len) {
+    if (!this->is_ready() || millis() - start >= TIMEOUT_MS) {
+      return false;
+    }
+    this->receive_(micros());
+    App.feed_wdt();
+  }
+  this->rx_buffer_.pop(data, len);
+  return true;
+}
+
+int CDCACMComponent::available() { return this->rx_buffer_.size(); }
+
+void CDCACMComponent::flush() {
+  uint32_t start = millis();
+  while (!this->tx_buffer_.empty() && this->is_ready() && millis() - start < TIMEOUT_MS) {
+    this->transmit_(micros());
+    App.feed_wdt();
+  }
+}
+
+}  // namespace max3421e_cdc_acm
+}  // namespace esphome
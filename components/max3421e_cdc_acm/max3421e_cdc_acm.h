@@ -0,0 +1,95 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/components/uart/uart_component.h"
+#include "esphome/components/max3421e/max3421e.h"
+
+#include "cdcacm.h"
+
+#include "ring_buffer.h"
+
+#ifndef MAX3421E_CDC_ACM_LOOP_BUDGET_US
+// time a single loop() may spend moving data between the device and the buffers.
+#define MAX3421E_CDC_ACM_LOOP_BUDGET_US 2000
+#endif
+// bulk endpoints of full speed devices use packets of up to 64 bytes.
+#define MAX3421E_CDC_ACM_PACKET_SIZE 64
+// upper bound of a single bulk transfer, it ends earlier on a short packet.
+#define MAX3421E_CDC_ACM_MAX_TRANSFER_SIZE 512
+
+namespace esphome {
+namespace max3421e_cdc_acm {
+
+// ACM driver counting its data transfers in the statistics of the MAX3421E.
+class StatsACM : public ACM {
+ public:
+  StatsACM(max3421e::MAX3421EComponent *parent, CDCAsyncOper *pasync)
+      : ACM(parent->getUsb(), pasync), parent_(parent) {}
+
+  // RcvData() and SndData() of the ACM driver are not virtual, the component calls these wrappers instead.
+  uint8_t receive(uint16_t *bytes_rcvd, uint8_t *dataptr);
+  uint8_t send(uint16_t nbytes, uint8_t *dataptr);
+
+  // address of the bulk IN endpoint with direction bit.
+  uint8_t in_endpoint() const { return this->epInfo[epDataInIndex].epAddr | max3421e::STATS_ENDPOINT_IN; }
+
+ protected:
+  max3421e::MAX3421EComponent *parent_;
+};
+
+// CDC-ACM device on the MAX3421E exposed as a UART bus, usable with `uart_id` by other components.
+class CDCACMComponent : public uart::UARTComponent, public Component, public CDCAsyncOper {
+ public:
+  void setup() override;
+  void loop() override;
+  void dump_config() override;
+  float get_setup_priority() const override;
+
+  void set_parent(max3421e::MAX3421EComponent *parent) { this->parent_ = parent; }
+  void set_tx_buffer_size(size_t tx_buffer_size) { this->tx_buffer_size_ = tx_buffer_size; }
+  void set_benchmark_interval(uint32_t benchmark_interval) { this->benchmark_interval_ = benchmark_interval; }
+
+  // uart::UARTComponent
+  using uart::UARTComponent::write_array;
+  void write_array(const uint8_t *data, size_t len) override;
+  bool peek_byte(uint8_t *data) override;
+  bool read_array(uint8_t *data, size_t len) override;
+  int available() override;
+  void flush() override;
+
+  // CDCAsyncOper, called by the ACM driver once the device is configured.
+  uint8_t OnInit(ACM *pacm) override;
+
+  bool is_ready() { return this->acm_ != nullptr && this->acm_->isReady() && !this->parent_->isSuspended(); }
+
+ protected:
+  void check_logger_conflict() override {}
+
+  // function to pull data from the bulk IN endpoint into the RX buffer until the device has nothing more,
+  // the buffer is full or the loop budget is used up. Returns hrNAK if nothing was received.
+  uint8_t receive_(uint32_t started);
+  // function to push data from the TX buffer to the bulk OUT endpoint.
+  void transmit_(uint32_t started);
+  // function to log the throughput since the last report.
+  void report_benchmark_();
+
+  max3421e::MAX3421EComponent *parent_{nullptr};
+  StatsACM *acm_{nullptr};
+  size_t tx_buffer_size_{1024};
+  ByteRing rx_buffer_;
+  ByteRing tx_buffer_;
+  // used when the free space in the RX buffer wraps around in the middle of a packet
+  uint8_t bounce_[MAX3421E_CDC_ACM_PACKET_SIZE];
+
+  uint32_t benchmark_interval_{0};
+  uint32_t benchmark_last_{0};
+  uint32_t rx_bytes_{0};
+  uint32_t tx_bytes_{0};
+  uint32_t rx_transfers_{0};
+  uint32_t tx_transfers_{0};
+  uint32_t rx_stalled_{0};  // loops the RX buffer was too full to receive
+  uint32_t busy_us_{0};     // time spent in transfers
+};
+
+}  // namespace max3421e_cdc_acm
+}  // namespace esphome
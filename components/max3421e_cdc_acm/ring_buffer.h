@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace esphome {
+namespace max3421e_cdc_acm {
+
+// Single producer / single consumer byte ring buffer.
+// The producer only moves head_ and the consumer only moves tail_, so no lock is needed.
+// Capacity is rounded up to a power of two, indexes wrap by masking.
+class ByteRing {
+ public:
+  void init(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    this->buf_.reset(new uint8_t[size]);  // NOLINT(cppcoreguidelines-owning-memory)
+    this->mask_ = size - 1;
+    this->head_.store(0, std::memory_order_relaxed);
+    this->tail_.store(0, std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return this->mask_ + 1; }
+  size_t size() const {
+    return this->head_.load(std::memory_order_acquire) - this->tail_.load(std::memory_order_acquire);
+  }
+  size_t space() const { return this->capacity() - this->size(); }
+  bool empty() const { return this->size() == 0; }
+
+  // producer side
+
+  // returns the contiguous free space and its length, fill it and commit() the bytes written.
+  uint8_t *write_region(size_t *len) {
+    size_t head = this->head_.load(std::memory_order_relaxed);
+    size_t to_end = this->capacity() - (head & this->mask_);
+    *len = std::min(this->space(), to_end);
+    return &this->buf_[head & this->mask_];
+  }
+  void commit(size_t len) {
+    this->head_.store(this->head_.load(std::memory_order_relaxed) + len, std::memory_order_release);
+  }
+  // copies as many bytes as fit and returns their count.
+  size_t push(const uint8_t *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+      size_t region_len;
+      uint8_t *region = this->write_region(&region_len);
+      if (region_len == 0) {
+        break;
+      }
+      size_t n = std::min(region_len, len - done);
+      memcpy(region, data + done, n);
+      this->commit(n);
+      done += n;
+    }
+    return done;
+  }
+
+  // consumer side
+
+  // returns the contiguous readable data and its length, consume() the bytes used.
+  uint8_t *read_region(size_t *len) {
+    size_t tail = this->tail_.load(std::memory_order_relaxed);
+    size_t to_end = this->capacity() - (tail & this->mask_);
+    *len = std::min(this->size(), to_end);
+    return &this->buf_[tail & this->mask_];
+  }
+  void consume(size_t len) {
+    this->tail_.store(this->tail_.load(std::memory_order_relaxed) + len, std::memory_order_release);
+  }
+  bool peek(uint8_t *data) {
+    size_t len;
+    uint8_t *region = this->read_region(&len);
+    if (len == 0) {
+      return false;
+    }
+    *data = *region;
+    return true;
+  }
+  // copies up to len bytes and returns their count.
+  size_t pop(uint8_t *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+      size_t region_len;
+      uint8_t *region = this->read_region(&region_len);
+      if (region_len == 0) {
+        break;
+      }
+      size_t n = std::min(region_len, len - done);
+      memcpy(data + done, region, n);
+      this->consume(n);
+      done += n;
+    }
+    return done;
+  }
+  // drops all buffered bytes.
+  void clear() { this->tail_.store(this->head_.load(std::memory_order_acquire), std::memory_order_release); }
+
+ protected:
+  std::unique_ptr<uint8_t[]> buf_;
+  size_t mask_{0};
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+};
+
+}  // namespace max3421e_cdc_acm
+}  // namespace esphome
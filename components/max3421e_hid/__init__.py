@@ -0,0 +1,63 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome import automation
+from esphome.components.max3421e import CONF_MAX3421E_ID, MAX3421EComponent
+from esphome.const import CONF_ID, CONF_TRIGGER_ID
+
+DEPENDENCIES = ["max3421e"]
+
+CONF_MAX3421E_HID_ID = "max3421e_hid_id"
+CONF_TERMINATOR = "terminator"
+CONF_SCAN_TIMEOUT = "scan_timeout"
+CONF_ON_SCAN = "on_scan"
+
+max3421e_hid_ns = cg.esphome_ns.namespace("max3421e_hid")
+HIDKeyboardComponent = max3421e_hid_ns.class_(
+    "HIDKeyboardComponent", cg.Component
+)
+ScanTrigger = max3421e_hid_ns.class_(
+    "ScanTrigger", automation.Trigger.template(cg.std_string)
+)
+
+ScanTerminator = max3421e_hid_ns.enum("ScanTerminator")
+SCAN_TERMINATORS = {
+    "NONE": ScanTerminator.SCAN_TERMINATOR_NONE,
+    "ENTER": ScanTerminator.SCAN_TERMINATOR_ENTER,
+    "TAB": ScanTerminator.SCAN_TERMINATOR_TAB,
+}
+
+
+def _validate_scan_end(config):
+    if config[CONF_TERMINATOR] == "NONE" and config[CONF_SCAN_TIMEOUT].total_milliseconds == 0:
+        raise cv.Invalid(f"{CONF_SCAN_TIMEOUT} is required without {CONF_TERMINATOR}")
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
+    cv.Schema({
+        cv.GenerateID(): cv.declare_id(HIDKeyboardComponent),
+        cv.GenerateID(CONF_MAX3421E_ID): cv.use_id(MAX3421EComponent),
+        cv.Optional(CONF_TERMINATOR, default="ENTER"): cv.enum(SCAN_TERMINATORS, upper=True),  # type: ignore[arg-type]
+        # complete a scan once no key arrived for this time, 0ms waits for the terminator.
+        cv.Optional(CONF_SCAN_TIMEOUT, default="0ms"): cv.positive_time_period_milliseconds,  # type: ignore[arg-type]
+        cv.Optional(CONF_ON_SCAN): automation.validate_automation({
+            cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(ScanTrigger),
+        }),
+    }).extend(cv.COMPONENT_SCHEMA),
+    _validate_scan_end,
+)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    parent = await cg.get_variable(config[CONF_MAX3421E_ID])
+    cg.add(var.set_parent(parent))
+
+    cg.add(var.set_terminator(config[CONF_TERMINATOR]))
+    cg.add(var.set_scan_timeout(config[CONF_SCAN_TIMEOUT].total_milliseconds))
+
+    for conf in config.get(CONF_ON_SCAN, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(cg.std_string, "x")], conf)
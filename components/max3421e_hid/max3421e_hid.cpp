@@ -0,0 +1,157 @@
+#include "max3421e_hid.h"
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace max3421e_hid {
+
+static const char *const TAG = "max3421e_hid";
+
+// boot protocol key codes
+static const uint8_t KEY_ENTER = 0x28;
+static const uint8_t KEY_TAB = 0x2B;
+static const uint8_t KEY_KEYPAD_ENTER = 0x58;
+
+static const char *terminator_name(ScanTerminator terminator) {
+  switch (terminator) {
+    case SCAN_TERMINATOR_ENTER:
+      return "ENTER";
+    case SCAN_TERMINATOR_TAB:
+      return "TAB";
+    default:
+      return "NONE";
+  }
+}
+
+uint8_t ScheduledHIDBoot::Init(uint8_t parent, uint8_t port, bool lowspeed) {
+  this->endpoint_ = 0;
+  uint8_t rcode = HIDBoot<USB_HID_PROTOCOL_KEYBOARD>::Init(parent, port, lowspeed);
+  if (rcode) {
+    return rcode;
+  }
+  if (this->endpoint_ == 0) {
+    ESP_LOGW(TAG, "No interrupt endpoint found on device 0x%02X", this->GetAddress());
+    return 0;
+  }
+  this->parent_->getScheduler()->add(this->GetAddress(), this->endpoint_, max3421e::ENDPOINT_INTERRUPT,
+                                     max3421e::EndpointScheduler::interval_frames(this->interval_),
+                                     [this]() { return this->scheduled_poll_(); });
+  return 0;
+}
+
+void ScheduledHIDBoot::EndpointXtract(uint32_t conf, uint32_t iface, uint32_t alt, uint32_t proto,
+                                      const USB_ENDPOINT_DESCRIPTOR *ep) {
+  if ((ep->bmAttributes & 0x03) == USB_TRANSFER_TYPE_INTERRUPT && (ep->bEndpointAddress & 0x80) &&
+      this->endpoint_ == 0) {
+    this->endpoint_ = ep->bEndpointAddress;
+    this->interval_ = ep->bInterval;
+  }
+  HIDBoot<USB_HID_PROTOCOL_KEYBOARD>::EndpointXtract(conf, iface, alt, proto, ep);
+}
+
+uint8_t ScheduledHIDBoot::poll() {
+  // the library skips polls before its own next poll time, which it sets one bInterval after the last poll.
+  // The scheduler decides when to poll, a late poll would otherwise make the library skip the next one.
+  this->qNextPollTime = millis();
+  this->polling_ = true;
+  uint8_t rcode = this->Poll();
+  this->polling_ = false;
+  return rcode;
+}
+
+void HIDKeyboardComponent::setup() {
+  ESP_LOGCONFIG(TAG, "Setting up MAX3421E HID keyboard...");
+  // registers itself as device class at the USB host
+  this->hid_ = new ScheduledHIDBoot(this->parent_, [this]() { return this->poll(); });  // NOLINT
+  this->hid_->SetReportParser(0, this);
+}
+
+void HIDKeyboardComponent::dump_config() {
+  ESP_LOGCONFIG(TAG, "MAX3421E HID keyboard:");
+  ESP_LOGCONFIG(TAG, "  Terminator:   %s", terminator_name(this->terminator_));
+  ESP_LOGCONFIG(TAG, "  Scan Timeout: %ums", this->scan_timeout_);
+#ifdef USE_TEXT_SENSOR
+  LOG_TEXT_SENSOR("  ", "Scan", this->scan_sensor_);
+#endif
+#ifdef USE_SENSOR
+  LOG_SENSOR("  ", "Latency", this->latency_sensor_);
+#endif
+}
+
+float HIDKeyboardComponent::get_setup_priority() const { return setup_priority::DATA; }
+
+void HIDKeyboardComponent::loop() {
+  // scans without terminator are complete once no more keys arrive
+  if (this->scan_timeout_ > 0 && !this->scan_.empty() && millis() - this->last_key_ms_ >= this->scan_timeout_) {
+    this->finishScan();
+  }
+}
+
+uint8_t HIDKeyboardComponent::poll() {
+  uint8_t addr = this->hid_->GetAddress();
+  this->report_len_ = 0;
+  // a key pressed right after the previous poll waits in the device for one interval plus the time this poll is late
+  this->poll_wait_us_ = (this->hid_->interval() + this->parent_->getScheduler()->current_late()) * 1000;
+  uint32_t start = micros();
+  uint8_t rcode = this->hid_->poll();
+  if (rcode == 0 && this->report_len_ == 0) {
+    // the keyboard had nothing new, the library returns 0 on NAK
+    rcode = hrNAK;
+  }
+  this->parent_->getStats()->record_since(addr, this->hid_->endpoint(), rcode, this->report_len_, start);
+  return rcode;
+}
+
+void HIDKeyboardComponent::Parse(USBHID *hid, bool is_rpt_id, uint8_t len, uint8_t *buf) {
+  this->report_len_ = len;
+  this->report_us_ = micros() - this->poll_wait_us_;
+  KeyboardReportParser::Parse(hid, is_rpt_id, len, buf);
+}
+
+void HIDKeyboardComponent::OnKeyDown(uint8_t mod, uint8_t key) {
+  if ((this->terminator_ == SCAN_TERMINATOR_ENTER && (key == KEY_ENTER || key == KEY_KEYPAD_ENTER)) ||
+      (this->terminator_ == SCAN_TERMINATOR_TAB && key == KEY_TAB)) {
+    this->last_key_us_ = this->report_us_;
+    // publish right from the poll, so the scan doesn't wait for the next loop
+    this->finishScan();
+    return;
+  }
+  uint8_t c = this->OemToAscii(mod, key);
+  if (c == 0 || c == '\r' || c == '\n') {
+    return;
+  }
+  if (this->scan_.size() >= MAX3421E_HID_MAX_SCAN_LEN) {
+    ESP_LOGW(TAG, "Scan longer than %d characters, dropping key", MAX3421E_HID_MAX_SCAN_LEN);
+    return;
+  }
+  this->scan_ += (char) c;
+  this->last_key_us_ = this->report_us_;
+  this->last_key_ms_ = millis();
+}
+
+void HIDKeyboardComponent::finishScan() {
+  if (this->scan_.empty()) {
+    return;
+  }
+  std::string scan;
+  scan.swap(this->scan_);
+  ESP_LOGD(TAG, "Scan: %s", scan.c_str());
+#ifdef USE_TEXT_SENSOR
+  if (this->scan_sensor_ != nullptr) {
+    this->scan_sensor_->publish_state(scan);
+  }
+#endif
+  this->scan_callback_.call(scan);
+  // time from the last key press until the scan was published, taking the longest the key may have waited in the
+  // device for its poll. Includes the scan timeout if no terminator was received.
+  float latency = (micros() - this->last_key_us_) / 1000.0f;
+  ESP_LOGV(TAG, "Scan latency: %.2fms", latency);
+#ifdef USE_SENSOR
+  if (this->latency_sensor_ != nullptr) {
+    this->latency_sensor_->publish_state(latency);
+  }
+#endif
+}
+
+}  // namespace max3421e_hid
+}  // namespace esphome
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "esphome/core/component.h"
+#include "esphome/core/defines.h"
+#include "esphome/components/max3421e/max3421e.h"
+
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
+#ifdef USE_TEXT_SENSOR
+#include "esphome/components/text_sensor/text_sensor.h"
+#endif
+
+#include "hidboot.h"
+
+#ifndef MAX3421E_HID_MAX_SCAN_LEN
+#define MAX3421E_HID_MAX_SCAN_LEN 256
+#endif
+
+namespace esphome {
+namespace max3421e_hid {
+
+enum ScanTerminator : uint8_t {
+  SCAN_TERMINATOR_NONE = 0,
+  SCAN_TERMINATOR_ENTER,
+  SCAN_TERMINATOR_TAB,
+};
+
+// Boot keyboard driver leaving the polls of its interrupt endpoint to the scheduler of the MAX3421E.
+class ScheduledHIDBoot : public HIDBoot<USB_HID_PROTOCOL_KEYBOARD> {
+ public:
+  ScheduledHIDBoot(max3421e::MAX3421EComponent *parent, std::function<uint8_t()> &&poll)
+      : HIDBoot<USB_HID_PROTOCOL_KEYBOARD>(parent->getUsb()), parent_(parent), scheduled_poll_(std::move(poll)) {}
+
+  uint8_t Init(uint8_t parent, uint8_t port, bool lowspeed) override;
+  // called by the USB host task for all devices, only polls when called from poll().
+  uint8_t Poll() override { return this->polling_ ? HIDBoot<USB_HID_PROTOCOL_KEYBOARD>::Poll() : 0; }
+  void EndpointXtract(uint32_t conf, uint32_t iface, uint32_t alt, uint32_t proto,
+                      const USB_ENDPOINT_DESCRIPTOR *ep) override;
+
+  // poll the interrupt endpoint now, returns the result code of the transfer.
+  uint8_t poll();
+  uint8_t endpoint() const { return this->endpoint_; }
+  // frames between polls of the interrupt endpoint.
+  uint8_t interval() const { return max3421e::EndpointScheduler::interval_frames(this->interval_); }
+
+ protected:
+  max3421e::MAX3421EComponent *parent_;
+  // polls through the component, which counts the reports in the statistics
+  std::function<uint8_t()> scheduled_poll_;
+  bool polling_{false};
+  // interrupt IN endpoint and its bInterval found in the configuration
+  uint8_t endpoint_{0};
+  uint8_t interval_{0};
+};
+
+// Boot protocol keyboard on the MAX3421E, collecting key presses into scans (e.g. of a barcode scanner).
+// The scheduler of the MAX3421E polls the interrupt endpoint in the bInterval of the device.
+class HIDKeyboardComponent : public Component, public KeyboardReportParser {
+ public:
+  void setup() override;
+  void loop() override;
+  void dump_config() override;
+  float get_setup_priority() const override;
+
+  void set_parent(max3421e::MAX3421EComponent *parent) { this->parent_ = parent; }
+  void set_terminator(ScanTerminator terminator) { this->terminator_ = terminator; }
+  void set_scan_timeout(uint32_t scan_timeout) { this->scan_timeout_ = scan_timeout; }
+#ifdef USE_TEXT_SENSOR
+  void set_scan_sensor(text_sensor::TextSensor *scan_sensor) { this->scan_sensor_ = scan_sensor; }
+#endif
+#ifdef USE_SENSOR
+  void set_latency_sensor(sensor::Sensor *latency_sensor) { this->latency_sensor_ = latency_sensor; }
+#endif
+  void add_on_scan_callback(std::function<void(std::string)> &&callback) {
+    this->scan_callback_.add(std::move(callback));
+  }
+
+  // KeyboardReportParser, called for each report polled from the device.
+  void Parse(USBHID *hid, bool is_rpt_id, uint8_t len, uint8_t *buf) override;
+
+ protected:
+  void OnKeyDown(uint8_t mod, uint8_t key) override;
+
+  // function to publish the collected scan.
+  void finishScan();
+  // function to poll the keyboard, called by the scheduler.
+  uint8_t poll();
+
+  max3421e::MAX3421EComponent *parent_{nullptr};
+  ScheduledHIDBoot *hid_{nullptr};
+  ScanTerminator terminator_{SCAN_TERMINATOR_ENTER};
+  uint32_t scan_timeout_{0};
+
+  std::string scan_;
+  uint8_t report_len_{0};     // length of the last report, 0 if none arrived since the poll started
+  uint32_t poll_wait_us_{0};  // time a key press may have waited in the device before the current poll
+  uint32_t report_us_{0};     // earliest key press of the report being parsed
+  uint32_t last_key_us_{0};   // earliest key press of the report with the last key of the scan
+  uint32_t last_key_ms_{0};
+
+#ifdef USE_TEXT_SENSOR
+  text_sensor::TextSensor *scan_sensor_{nullptr};
+#endif
+#ifdef USE_SENSOR
+  sensor::Sensor *latency_sensor_{nullptr};
+#endif
+  CallbackManager<void(std::string)> scan_callback_{};
+};
+
+class ScanTrigger : public Trigger<std::string> {
+ public:
+  explicit ScanTrigger(HIDKeyboardComponent *parent) {
+    parent->add_on_scan_callback([this](const std::string &scan) { this->trigger(scan); });
+  }
+};
+
+}  // namespace max3421e_hid
+}  // namespace esphome
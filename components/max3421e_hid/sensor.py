@@ -0,0 +1,33 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    UNIT_MILLISECOND,
+)
+
+from . import CONF_MAX3421E_HID_ID, HIDKeyboardComponent
+
+DEPENDENCIES = ["max3421e_hid", "sensor"]
+
+CONF_LATENCY = "latency"
+
+CONFIG_SCHEMA = cv.Schema({
+    cv.GenerateID(CONF_MAX3421E_HID_ID): cv.use_id(HIDKeyboardComponent),
+    cv.Optional(CONF_LATENCY): sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        accuracy_decimals=2,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:timer-outline",
+    ),
+})
+
+
+async def to_code(config):
+    component = await cg.get_variable(config[CONF_MAX3421E_HID_ID])
+
+    if CONF_LATENCY in config:
+        var = await sensor.new_sensor(config[CONF_LATENCY])
+        cg.add(component.set_latency_sensor(var))
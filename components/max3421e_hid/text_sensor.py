@@ -0,0 +1,24 @@
+from esphome.components import text_sensor
+import esphome.config_validation as cv
+import esphome.codegen as cg
+
+from . import CONF_MAX3421E_HID_ID, HIDKeyboardComponent
+
+DEPENDENCIES = ["max3421e_hid", "text_sensor"]
+
+CONF_SCAN = "scan"
+
+CONFIG_SCHEMA = cv.Schema({
+    cv.GenerateID(CONF_MAX3421E_HID_ID): cv.use_id(HIDKeyboardComponent),
+    cv.Optional(CONF_SCAN): text_sensor.text_sensor_schema(
+        icon="mdi:barcode-scan",
+    ),
+})
+
+
+async def to_code(config):
+    component = await cg.get_variable(config[CONF_MAX3421E_HID_ID])
+
+    if CONF_SCAN in config:
+        var = await text_sensor.new_text_sensor(config[CONF_SCAN])
+        cg.add(component.set_scan_sensor(var))
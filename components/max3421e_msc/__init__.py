@@ -0,0 +1,105 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome import automation
+from esphome.components.max3421e import CONF_MAX3421E_ID, MAX3421EComponent
+from esphome.const import CONF_DATA, CONF_ID
+
+DEPENDENCIES = ["max3421e"]
+
+CONF_MAX3421E_MSC_ID = "max3421e_msc_id"
+CONF_LUN = "lun"
+CONF_BUFFER_BLOCKS = "buffer_blocks"
+CONF_LOG = "log"
+CONF_START_BLOCK = "start_block"
+CONF_BLOCK_COUNT = "block_count"
+CONF_FLUSH_INTERVAL = "flush_interval"
+CONF_BENCHMARK_BLOCKS = "benchmark_blocks"
+CONF_BENCHMARK_INTERVAL = "benchmark_interval"
+
+max3421e_msc_ns = cg.esphome_ns.namespace("max3421e_msc")
+MSCComponent = max3421e_msc_ns.class_("MSCComponent", cg.Component)
+AppendAction = max3421e_msc_ns.class_(
+    "AppendAction", automation.Action, cg.Parented.template(MSCComponent)
+)
+FlushAction = max3421e_msc_ns.class_(
+    "FlushAction", automation.Action, cg.Parented.template(MSCComponent)
+)
+
+
+def _validate_benchmark(config):
+    if config[CONF_BENCHMARK_BLOCKS] > 0 and CONF_LOG not in config:
+        raise cv.Invalid(f"{CONF_BENCHMARK_BLOCKS} writes behind the log and requires {CONF_LOG}")
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
+    cv.Schema({
+        cv.GenerateID(): cv.declare_id(MSCComponent),
+        cv.GenerateID(CONF_MAX3421E_ID): cv.use_id(MAX3421EComponent),
+        cv.Optional(CONF_LUN, default=0): cv.int_range(min=0, max=15),  # type: ignore[arg-type]
+        # blocks per buffer, written with a single transfer. Two buffers are allocated, each of up to 32KiB
+        # (MAX3421E_MSC_MAX_BUFFER_SIZE), so the maximum only fits devices with 512 byte blocks.
+        cv.Optional(CONF_BUFFER_BLOCKS, default=8): cv.int_range(min=1, max=64),  # type: ignore[arg-type]
+        # append-only log in a range of blocks, overwriting whatever is stored there.
+        cv.Optional(CONF_LOG): cv.Schema({
+            cv.Required(CONF_START_BLOCK): cv.positive_int,  # type: ignore[arg-type]
+            # 0 uses the rest of the device.
+            cv.Optional(CONF_BLOCK_COUNT, default=0): cv.positive_int,  # type: ignore[arg-type]
+            # longest time data stays in the buffers.
+            cv.Optional(CONF_FLUSH_INTERVAL, default="10s"): cv.All(
+                cv.positive_time_period_milliseconds, cv.Range(min=cv.TimePeriod(seconds=1))
+            ),  # type: ignore[arg-type]
+        }),
+        # write and read this many blocks behind the log once after boot and log the throughput, 0 disables it.
+        cv.Optional(CONF_BENCHMARK_BLOCKS, default=0): cv.int_range(min=0, max=65536),  # type: ignore[arg-type]
+        # log the sustained throughput of the log in this interval, 0s disables it.
+        cv.Optional(CONF_BENCHMARK_INTERVAL, default="0s"): cv.time_period,  # type: ignore[arg-type]
+    }).extend(cv.COMPONENT_SCHEMA),
+    _validate_benchmark,
+)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    parent = await cg.get_variable(config[CONF_MAX3421E_ID])
+    cg.add(var.set_parent(parent))
+
+    cg.add(var.set_lun(config[CONF_LUN]))
+    cg.add(var.set_buffer_blocks(config[CONF_BUFFER_BLOCKS]))
+    if CONF_LOG in config:
+        log = config[CONF_LOG]
+        cg.add(var.set_log(log[CONF_START_BLOCK], log[CONF_BLOCK_COUNT]))
+        cg.add(var.set_flush_interval(log[CONF_FLUSH_INTERVAL].total_milliseconds))
+    cg.add(var.set_benchmark_blocks(config[CONF_BENCHMARK_BLOCKS]))
+    cg.add(var.set_benchmark_interval(config[CONF_BENCHMARK_INTERVAL].total_milliseconds))
+
+
+@automation.register_action(
+    "max3421e_msc.append",
+    AppendAction,
+    cv.maybe_simple_value({
+        cv.GenerateID(): cv.use_id(MSCComponent),
+        cv.Required(CONF_DATA): cv.templatable(cv.string),
+    }, key=CONF_DATA),
+)
+async def append_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    data = await cg.templatable(config[CONF_DATA], args, cg.std_string)
+    cg.add(var.set_data(data))
+    return var
+
+
+@automation.register_action(
+    "max3421e_msc.flush",
+    FlushAction,
+    cv.Schema({
+        cv.GenerateID(): cv.use_id(MSCComponent),
+    }),
+)
+async def flush_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
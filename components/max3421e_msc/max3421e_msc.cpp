@@ -0,0 +1,522 @@
+#include "max3421e_msc.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "esphome/core/application.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace max3421e_msc {
+
+static const char *const TAG = "max3421e_msc";
+
+// wait before trying a device again after a failed transfer, e.g. while a stick is still busy after attaching.
+static const uint32_t RETRY_INTERVAL_MS = 1000;
+
+uint8_t StatsBulkOnly::read(uint8_t lun, uint32_t lba, uint16_t block_size, uint8_t blocks, uint8_t *buf) {
+  // the driver releases the device on errors, so keep what identifies the endpoint
+  uint8_t addr = this->bAddress;
+  uint8_t ep = this->epInfo[epDataInIndex].epAddr | max3421e::STATS_ENDPOINT_IN;
+  uint32_t start = micros();
+  uint8_t rcode = this->Read(lun, lba, block_size, blocks, buf);
+  this->parent_->getStats()->record_since(addr, ep, rcode, rcode ? 0 : (uint32_t) blocks * block_size, start);
+  return rcode;
+}
+
+uint8_t StatsBulkOnly::write(uint8_t lun, uint32_t lba, uint16_t block_size, uint8_t blocks, const uint8_t *buf) {
+  uint8_t addr = this->bAddress;
+  uint8_t ep = this->epInfo[epDataOutIndex].epAddr;
+  uint32_t start = micros();
+  uint8_t rcode = this->Write(lun, lba, block_size, blocks, buf);
+  this->parent_->getStats()->record_since(addr, ep, rcode, rcode ? 0 : (uint32_t) blocks * block_size, start);
+  return rcode;
+}
+
+void MSCComponent::setup() {
+  ESP_LOGCONFIG(TAG, "Setting up MAX3421E MSC...");
+  // registers itself as device class at the USB host
+  this->msc_ = new StatsBulkOnly(this->parent_);  // NOLINT(cppcoreguidelines-owning-memory)
+  if (this->log_) {
+    // data appended before a device is attached is kept, assuming the usual block size
+    this->alloc_buffers_(this->block_size_);
+  }
+  this->flush_last_ = millis();
+  this->benchmark_last_ = millis();
+}
+
+void MSCComponent::dump_config() {
+  ESP_LOGCONFIG(TAG, "MAX3421E MSC:");
+  ESP_LOGCONFIG(TAG, "  LUN:                %u", this->lun_);
+  ESP_LOGCONFIG(TAG, "  Max Transfer:       %u blocks", MAX3421E_MSC_MAX_TRANSFER_BLOCKS);
+  if (this->log_) {
+    ESP_LOGCONFIG(TAG, "  Log Start Block:    %u", (unsigned) this->log_start_);
+    if (this->log_count_ > 0) {
+      ESP_LOGCONFIG(TAG, "  Log Blocks:         %u", (unsigned) this->log_count_);
+    } else {
+      ESP_LOGCONFIG(TAG, "  Log Blocks:         rest of the device");
+    }
+    ESP_LOGCONFIG(TAG, "  Buffers:            2 x %u blocks", this->buffer_blocks_);
+    ESP_LOGCONFIG(TAG, "  Flush Interval:     %us", (unsigned) (this->flush_interval_ / 1000));
+  }
+  ESP_LOGCONFIG(TAG, "  Benchmark Blocks:   %u", (unsigned) this->benchmark_blocks_);
+  ESP_LOGCONFIG(TAG, "  Benchmark Interval: %us", (unsigned) (this->benchmark_interval_ / 1000));
+#ifdef USE_SENSOR
+  LOG_SENSOR("  ", "Log Size", this->log_size_sensor_);
+  LOG_SENSOR("  ", "Log Free", this->log_free_sensor_);
+  LOG_SENSOR("  ", "Dropped", this->dropped_sensor_);
+#endif
+}
+
+float MSCComponent::get_setup_priority() const { return setup_priority::BUS; }
+
+void MSCComponent::alloc_buffers_(uint16_t block_size) {
+  this->block_size_ = block_size;
+  this->buffers_[0].assign((size_t) block_size * this->buffer_blocks_, 0);
+  this->buffers_[1].assign((size_t) block_size * this->buffer_blocks_, 0);
+  this->block_.assign(block_size, 0);
+  this->fill_ = 0;
+  this->fill_len_ = 0;
+  this->flushed_len_ = 0;
+  this->pending_len_ = 0;
+  this->fill_done_ = 0;
+  this->pending_done_ = 0;
+}
+
+void MSCComponent::loop() {
+  bool present = this->is_present_();
+  if (!present) {
+    if (this->mounted_) {
+      ESP_LOGI(TAG, "Device detached, %u bytes left in the buffers", (unsigned) (this->pending_len_ + this->fill_len_));
+      this->mounted_ = false;
+    }
+    this->mount_failed_ = false;
+  } else if (!this->mounted_ && !this->mount_failed_ && millis() - this->retry_last_ >= RETRY_INTERVAL_MS) {
+    if (this->parent_->isSuspended()) {
+      this->parent_->requestResume();
+    } else {
+      this->mount_();
+    }
+  }
+
+  if (this->log_ && this->mounted_) {
+    bool flush_due = this->flush_requested_ || millis() - this->flush_last_ >= this->flush_interval_;
+    if (this->pending_len_ > 0 || (flush_due && this->fill_len_ > this->flushed_len_)) {
+      if (this->parent_->isSuspended()) {
+        // written once the bus is resumed
+        this->parent_->requestResume();
+      } else if (!this->write_failed_ || millis() - this->retry_last_ >= RETRY_INTERVAL_MS) {
+        uint32_t start = micros();
+        // a few blocks per loop, the buffer filled meanwhile follows once the full one is written
+        if (this->pending_len_ > 0) {
+          this->write_pending_();
+        } else {
+          this->flush_fill_();
+        }
+        this->busy_us_ += micros() - start;
+      }
+    } else if (flush_due) {
+      this->flush_requested_ = false;
+      this->flush_last_ = millis();
+      this->publish_sensors_();
+    }
+  }
+
+  if (this->benchmark_interval_ > 0 && millis() - this->benchmark_last_ >= this->benchmark_interval_) {
+    this->report_benchmark_();
+  }
+}
+
+void MSCComponent::on_shutdown() {
+  // best effort before a reboot, e.g. for an OTA update
+  if (!this->log_ || !this->is_ready()) {
+    return;
+  }
+  while (this->pending_len_ > 0 && this->write_pending_()) {
+  }
+  while (this->pending_len_ == 0 && this->fill_len_ > this->flushed_len_ && this->flush_fill_()) {
+  }
+}
+
+uint8_t MSCComponent::read_blocks(uint32_t lba, uint32_t count, uint8_t *buf) {
+  while (count > 0) {
+    if (!this->is_present_() || this->parent_->isSuspended()) {
+      return MASS_ERR_DEVICE_DISCONNECTED;
+    }
+    uint8_t blocks = std::min(count, (uint32_t) MAX3421E_MSC_MAX_TRANSFER_BLOCKS);
+    uint8_t rcode = this->msc_->read(this->lun_, lba, this->block_size_, blocks, buf);
+    if (rcode) {
+      return rcode;
+    }
+    lba += blocks;
+    count -= blocks;
+    buf += (size_t) blocks * this->block_size_;
+  }
+  return 0;
+}
+
+uint8_t MSCComponent::write_blocks(uint32_t lba, uint32_t count, const uint8_t *buf) {
+  while (count > 0) {
+    if (!this->is_present_() || this->parent_->isSuspended()) {
+      return MASS_ERR_DEVICE_DISCONNECTED;
+    }
+    uint8_t blocks = std::min(count, (uint32_t) MAX3421E_MSC_MAX_TRANSFER_BLOCKS);
+    uint8_t rcode = this->msc_->write(this->lun_, lba, this->block_size_, blocks, buf);
+    if (rcode) {
+      return rcode;
+    }
+    lba += blocks;
+    count -= blocks;
+    buf += (size_t) blocks * this->block_size_;
+  }
+  return 0;
+}
+
+void MSCComponent::mount_() {
+  this->retry_last_ = millis();
+  uint32_t capacity = this->msc_->GetCapacity(this->lun_);
+  uint16_t block_size = this->msc_->GetSectorSize(this->lun_);
+  if (block_size < MAX3421E_MSC_MIN_BLOCK_SIZE || block_size > MAX3421E_MSC_MAX_BLOCK_SIZE ||
+      block_size % MAX3421E_MSC_MIN_BLOCK_SIZE != 0) {
+    ESP_LOGE(TAG, "Block size of %u bytes not supported", block_size);
+    this->mount_failed_ = true;
+    return;
+  }
+  if (this->log_ && (size_t) block_size * this->buffer_blocks_ > MAX3421E_MSC_MAX_BUFFER_SIZE) {
+    ESP_LOGE(TAG, "Buffers of %u blocks of %u bytes exceed %u bytes, lower buffer_blocks", this->buffer_blocks_,
+             block_size, (unsigned) MAX3421E_MSC_MAX_BUFFER_SIZE);
+    this->mount_failed_ = true;
+    return;
+  }
+  if (this->log_ && block_size != this->block_size_) {
+    size_t buffered = this->pending_len_ + this->fill_len_;
+    if (buffered > 0) {
+      ESP_LOGW(TAG, "Block size changed to %u bytes, dropped %u buffered bytes", block_size, (unsigned) buffered);
+      this->dropped_ += buffered;
+    }
+    this->alloc_buffers_(block_size);
+  }
+  this->block_size_ = block_size;
+  this->capacity_ = capacity;
+
+  if (this->log_) {
+    if (this->msc_->WriteProtected(this->lun_)) {
+      ESP_LOGE(TAG, "Device is write protected");
+      this->mount_failed_ = true;
+      return;
+    }
+    this->log_end_ = this->log_count_ > 0 ? this->log_start_ + this->log_count_ : capacity;
+    if (this->log_start_ >= this->log_end_ || this->log_end_ > capacity) {
+      ESP_LOGE(TAG, "Log blocks %u-%u exceed the %u blocks of the device", (unsigned) this->log_start_,
+               (unsigned) (this->log_end_ - 1), (unsigned) capacity);
+      this->mount_failed_ = true;
+      return;
+    }
+    if (!this->open_log_()) {
+      return;
+    }
+  }
+  this->mounted_ = true;
+  ESP_LOGI(TAG, "Mounted LUN %u of device 0x%02X: %u blocks of %u bytes (%u MB)", this->lun_,
+           this->msc_->GetAddress(), (unsigned) capacity, block_size,
+           (unsigned) ((uint64_t) capacity * block_size / 1000000));
+  if (this->log_ && this->benchmark_blocks_ > 0 && !this->benchmark_done_) {
+    this->benchmark_done_ = true;
+    this->run_benchmark_();
+  }
+  this->publish_sensors_();
+}
+
+bool MSCComponent::valid_block_(uint32_t lba) const {
+  const auto *header = reinterpret_cast<const MSC_LOG_BLOCK_HEADER *>(this->block_.data());
+  return header->magic == MAX3421E_MSC_LOG_MAGIC && header->log_id == this->log_id_ &&
+         header->index == lba - this->log_start_ && header->used <= this->payload_size_() &&
+         header->crc == crc16(this->block_.data() + sizeof(MSC_LOG_BLOCK_HEADER), header->used);
+}
+
+bool MSCComponent::open_log_() {
+  const auto *header = reinterpret_cast<const MSC_LOG_BLOCK_HEADER *>(this->block_.data());
+  uint8_t rcode = this->read_blocks(this->log_start_, 1, this->block_.data());
+  if (rcode) {
+    ESP_LOGW(TAG, "Reading block %u failed. Error code: 0x%02X", (unsigned) this->log_start_, rcode);
+    return false;
+  }
+  uint32_t log_id = this->log_id_;
+  bool buffered = this->pending_len_ > 0 || this->fill_len_ > 0;
+  this->log_id_ = header->log_id;
+  if (!this->valid_block_(this->log_start_)) {
+    // nothing logged yet, or the blocks hold something else
+    this->log_id_ = random_uint32();
+    this->next_lba_ = this->log_start_;
+    this->log_full_ = false;
+    this->log_opened_ = true;
+    ESP_LOGI(TAG, "Starting log %08X at block %u", (unsigned) this->log_id_, (unsigned) this->log_start_);
+    return true;
+  }
+
+  // blocks are only ever appended, so the valid ones are the first blocks of the range
+  uint32_t last = this->log_start_;
+  uint32_t invalid = this->log_end_;
+  while (invalid - last > 1) {
+    uint32_t mid = last + (invalid - last) / 2;
+    rcode = this->read_blocks(mid, 1, this->block_.data());
+    if (rcode) {
+      ESP_LOGW(TAG, "Reading block %u failed. Error code: 0x%02X", (unsigned) mid, rcode);
+      return false;
+    }
+    if (this->valid_block_(mid)) {
+      last = mid;
+    } else {
+      invalid = mid;
+    }
+  }
+  rcode = this->read_blocks(last, 1, this->block_.data());
+  if (rcode) {
+    ESP_LOGW(TAG, "Reading block %u failed. Error code: 0x%02X", (unsigned) last, rcode);
+    return false;
+  }
+
+  if (this->log_opened_ && buffered && this->log_id_ == log_id && last + 1 >= this->next_lba_) {
+    // the same device attached again, the buffers still hold the data of its last blocks
+  } else if (!buffered && header->used < this->payload_size_()) {
+    // continue the last block, it is written again with the next flush
+    memcpy(this->fill_buffer_() + sizeof(MSC_LOG_BLOCK_HEADER), this->block_.data() + sizeof(MSC_LOG_BLOCK_HEADER),
+           header->used);
+    this->fill_len_ = header->used;
+    this->flushed_len_ = header->used;
+    this->next_lba_ = last;
+  } else {
+    this->next_lba_ = last + 1;
+  }
+  this->log_full_ = this->next_lba_ >= this->log_end_;
+  this->log_opened_ = true;
+  ESP_LOGI(TAG, "Continuing log %08X at block %u, %u of %u blocks used", (unsigned) this->log_id_,
+           (unsigned) this->next_lba_, (unsigned) (this->next_lba_ - this->log_start_),
+           (unsigned) (this->log_end_ - this->log_start_));
+  if (this->log_full_) {
+    ESP_LOGE(TAG, "Log is full");
+  }
+  return true;
+}
+
+size_t MSCComponent::append(const uint8_t *data, size_t len) {
+  if (!this->log_ || this->buffers_[0].empty()) {
+    return 0;
+  }
+  size_t payload = this->payload_size_();
+  size_t done = 0;
+  while (done < len && !this->log_full_) {
+    if (this->fill_len_ == this->buffer_capacity_()) {
+      if (this->pending_len_ > 0) {
+        // both buffers full, the device does not keep up
+        break;
+      }
+      // blocks flushed before are complete, the pending buffer continues after them
+      this->pending_len_ = this->fill_len_;
+      this->pending_done_ = this->fill_done_;
+      this->fill_ ^= 1;
+      this->fill_len_ = 0;
+      this->flushed_len_ = 0;
+      this->fill_done_ = 0;
+    }
+    size_t block = this->fill_len_ / payload;
+    size_t offset = this->fill_len_ % payload;
+    size_t n = std::min(len - done, payload - offset);
+    memcpy(this->fill_buffer_() + block * this->block_size_ + sizeof(MSC_LOG_BLOCK_HEADER) + offset, data + done, n);
+    this->fill_len_ += n;
+    done += n;
+  }
+  if (done < len) {
+    if (!this->overflow_) {
+      ESP_LOGW(TAG, "%s, dropping data", this->log_full_ ? "Log is full" : "Buffers full");
+    }
+    this->overflow_ = true;
+    this->dropped_ += len - done;
+  } else {
+    this->overflow_ = false;
+  }
+  return done;
+}
+
+uint8_t MSCComponent::write_log_(uint8_t *buf, size_t len, uint32_t first, uint32_t max_blocks, uint32_t *blocks) {
+  size_t payload = this->payload_size_();
+  uint32_t needed = (len + payload - 1) / payload;
+  uint32_t lba = this->next_lba_ + first;
+  uint32_t room = lba < this->log_end_ ? this->log_end_ - lba : 0;
+  *blocks = std::min(std::min(needed - first, max_blocks), room);
+  size_t data = 0;
+  for (uint32_t i = first; i < first + *blocks; i++) {
+    uint8_t *block = buf + (size_t) i * this->block_size_;
+    auto *header = reinterpret_cast<MSC_LOG_BLOCK_HEADER *>(block);
+    header->magic = MAX3421E_MSC_LOG_MAGIC;
+    header->log_id = this->log_id_;
+    header->index = lba + (i - first) - this->log_start_;
+    header->used = std::min(len - i * payload, payload);
+    header->crc = crc16(block + sizeof(MSC_LOG_BLOCK_HEADER), header->used);
+    data += header->used;
+  }
+  if (*blocks > 0) {
+    uint8_t rcode = this->write_blocks(lba, *blocks, buf + (size_t) first * this->block_size_);
+    if (rcode) {
+      return rcode;
+    }
+    this->written_bytes_ += data;
+    this->write_transfers_++;
+  }
+  // counted once the part that fits is written, a failed write is retried
+  if (*blocks == room && first + room < needed) {
+    size_t dropped = len - (size_t) (first + room) * payload;
+    ESP_LOGE(TAG, "Log is full, dropped %u bytes", (unsigned) dropped);
+    this->dropped_ += dropped;
+    this->log_full_ = true;
+  }
+  return 0;
+}
+
+bool MSCComponent::write_pending_() {
+  uint32_t blocks;
+  uint8_t rcode = this->write_log_(this->pending_buffer_(), this->pending_len_, this->pending_done_,
+                                   MAX3421E_MSC_LOOP_BLOCKS, &blocks);
+  if (rcode) {
+    uint32_t lba = this->next_lba_ + this->pending_done_;
+    ESP_LOGW(TAG, "Writing blocks %u-%u failed. Error code: 0x%02X", (unsigned) lba, (unsigned) (lba + blocks - 1),
+             rcode);
+    this->write_failed_ = true;
+    this->retry_last_ = millis();
+    return false;
+  }
+  this->write_failed_ = false;
+  this->pending_done_ += blocks;
+  if (!this->log_full_ && (size_t) this->pending_done_ * this->payload_size_() < this->pending_len_) {
+    return true;
+  }
+  this->next_lba_ += this->pending_done_;
+  this->pending_len_ = 0;
+  this->pending_done_ = 0;
+  this->flush_last_ = millis();
+  return true;
+}
+
+bool MSCComponent::flush_fill_() {
+  uint32_t blocks;
+  uint8_t rcode =
+      this->write_log_(this->fill_buffer_(), this->fill_len_, this->fill_done_, MAX3421E_MSC_LOOP_BLOCKS, &blocks);
+  if (rcode) {
+    uint32_t lba = this->next_lba_ + this->fill_done_;
+    ESP_LOGW(TAG, "Flushing blocks %u-%u failed. Error code: 0x%02X", (unsigned) lba, (unsigned) (lba + blocks - 1),
+             rcode);
+    this->write_failed_ = true;
+    this->retry_last_ = millis();
+    return false;
+  }
+  this->write_failed_ = false;
+  if (this->log_full_) {
+    // nothing more fits, keep the buffer from being written again
+    this->next_lba_ += this->fill_done_ + blocks;
+    this->fill_len_ = 0;
+    this->flushed_len_ = 0;
+    this->fill_done_ = 0;
+  } else {
+    // the last block written is only complete if the buffer continues after it, otherwise it is written again
+    this->flushed_len_ = std::min(this->fill_len_, (size_t) (this->fill_done_ + blocks) * this->payload_size_());
+    this->fill_done_ = this->flushed_len_ / this->payload_size_();
+    if (this->flushed_len_ < this->fill_len_) {
+      // the rest follows with the next loops
+      return true;
+    }
+  }
+  this->flush_requested_ = false;
+  this->flush_last_ = millis();
+  this->publish_sensors_();
+  return true;
+}
+
+void MSCComponent::run_benchmark_() {
+  // behind the blocks the buffers will be written to, overwritten by the log later on
+  uint32_t lba = this->next_lba_ + 2 * this->buffer_blocks_;
+  if (lba + this->benchmark_blocks_ > this->log_end_) {
+    ESP_LOGW(TAG, "No room for %u benchmark blocks behind the log", (unsigned) this->benchmark_blocks_);
+    return;
+  }
+  uint32_t chunk = this->buffer_blocks_;
+  std::vector<uint8_t> buf((size_t) chunk * this->block_size_);
+  for (size_t i = 0; i < buf.size(); i++) {
+    buf[i] = i;  // can't be taken for a block of the log
+  }
+
+  uint32_t start = micros();
+  uint8_t rcode = 0;
+  for (uint32_t done = 0; done < this->benchmark_blocks_ && rcode == 0; done += chunk) {
+    rcode = this->write_blocks(lba + done, std::min(chunk, this->benchmark_blocks_ - done), buf.data());
+    App.feed_wdt();
+  }
+  uint32_t write_us = micros() - start;
+  if (rcode) {
+    ESP_LOGW(TAG, "Benchmark write failed. Error code: 0x%02X", rcode);
+    return;
+  }
+
+  uint32_t mismatches = 0;
+  start = micros();
+  for (uint32_t done = 0; done < this->benchmark_blocks_ && rcode == 0; done += chunk) {
+    uint32_t blocks = std::min(chunk, this->benchmark_blocks_ - done);
+    std::fill(buf.begin(), buf.end(), 0);
+    rcode = this->read_blocks(lba + done, blocks, buf.data());
+    for (size_t i = 0; i < (size_t) blocks * this->block_size_; i++) {
+      if (buf[i] != (uint8_t) i) {
+        mismatches++;
+      }
+    }
+    App.feed_wdt();
+  }
+  uint32_t read_us = micros() - start;
+  if (rcode) {
+    ESP_LOGW(TAG, "Benchmark read failed. Error code: 0x%02X", rcode);
+    return;
+  }
+
+  float bytes = (float) this->benchmark_blocks_ * this->block_size_;
+  ESP_LOGI(TAG, "Benchmark of %u blocks in transfers of %u blocks: write %.1f kB/s, read %.1f kB/s, %u bytes differ",
+           (unsigned) this->benchmark_blocks_, (unsigned) chunk, bytes / write_us * 1000.0f,
+           bytes / read_us * 1000.0f, (unsigned) mismatches);
+}
+
+void MSCComponent::report_benchmark_() {
+  uint32_t now = millis();
+  float elapsed = (now - this->benchmark_last_) / 1000.0f;
+  ESP_LOGI(TAG, "Log: %.1f kB/s (%u transfers), busy: %.1f%%, dropped: %u bytes, buffered: %u bytes",
+           this->written_bytes_ / elapsed / 1000.0f, (unsigned) this->write_transfers_,
+           this->busy_us_ / elapsed / 10000.0f, (unsigned) (this->dropped_ - this->dropped_last_),
+           (unsigned) (this->pending_len_ + this->fill_len_));
+  this->benchmark_last_ = now;
+  this->written_bytes_ = 0;
+  this->write_transfers_ = 0;
+  this->dropped_last_ = this->dropped_;
+  this->busy_us_ = 0;
+}
+
+void MSCComponent::publish_sensors_() {
+#ifdef USE_SENSOR
+  if (!this->log_opened_) {
+    return;
+  }
+  // whole blocks written, data in the buffers is counted once it is written
+  uint32_t written = this->next_lba_ + this->pending_done_ - this->log_start_;
+  size_t flushed = this->pending_len_ > 0 ? 0 : this->flushed_len_;
+  float size = (float) written * this->payload_size_() + flushed;
+  float free = (float) (this->log_end_ - this->log_start_ - written) * this->payload_size_() - flushed;
+  if (this->log_size_sensor_ != nullptr) {
+    this->log_size_sensor_->publish_state(size);
+  }
+  if (this->log_free_sensor_ != nullptr) {
+    this->log_free_sensor_->publish_state(free);
+  }
+  if (this->dropped_sensor_ != nullptr) {
+    this->dropped_sensor_->publish_state(this->dropped_);
+  }
+#endif
+}
+
+}  // namespace max3421e_msc
+}  // namespace esphome
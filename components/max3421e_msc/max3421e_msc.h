@@ -0,0 +1,212 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "esphome/core/automation.h"
+#include "esphome/core/component.h"
+#include "esphome/core/defines.h"
+#include "esphome/components/max3421e/max3421e.h"
+
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
+
+#include "masstorage.h"
+
+#ifndef MAX3421E_MSC_MAX_TRANSFER_BLOCKS
+// blocks moved by a single SCSI READ/WRITE command, longer transfers are split.
+#define MAX3421E_MSC_MAX_TRANSFER_BLOCKS 128
+#endif
+// block sizes the log supports, almost all sticks use 512 bytes.
+#define MAX3421E_MSC_MIN_BLOCK_SIZE 512
+#define MAX3421E_MSC_MAX_BLOCK_SIZE 4096
+#ifndef MAX3421E_MSC_LOOP_BLOCKS
+// blocks of the log written per loop, so a flush doesn't block other components for long.
+#define MAX3421E_MSC_LOOP_BLOCKS 8
+#endif
+#ifndef MAX3421E_MSC_MAX_BUFFER_SIZE
+// bytes per buffer (two are allocated), devices needing more with buffer_blocks aren't mounted.
+#define MAX3421E_MSC_MAX_BUFFER_SIZE 32768
+#endif
+// "ULOG" in the first bytes of every block of the log.
+#define MAX3421E_MSC_LOG_MAGIC 0x474F4C55
+
+namespace esphome {
+namespace max3421e_msc {
+
+// starts every block of the log, followed by `used` bytes of data. Little endian as written by the ESP32.
+typedef struct {
+  uint32_t magic;   // MAX3421E_MSC_LOG_MAGIC
+  uint32_t log_id;  // random, chosen when the log was started in the first block
+  uint32_t index;   // block number counted from the first block of the log
+  uint16_t used;    // bytes of data in the block, less than fit only in the last block of a flush
+  uint16_t crc;     // crc16 (MODBUS) of the data
+} MSC_LOG_BLOCK_HEADER;
+
+static_assert(sizeof(MSC_LOG_BLOCK_HEADER) == 16, "the log format relies on a 16 byte block header");
+
+// Bulk-only transport driver counting its block transfers in the statistics of the MAX3421E.
+class StatsBulkOnly : public BulkOnly {
+ public:
+  explicit StatsBulkOnly(max3421e::MAX3421EComponent *parent) : BulkOnly(parent->getUsb()), parent_(parent) {}
+
+  // read or write blocks with a single SCSI command, returns the result code.
+  uint8_t read(uint8_t lun, uint32_t lba, uint16_t block_size, uint8_t blocks, uint8_t *buf);
+  uint8_t write(uint8_t lun, uint32_t lba, uint16_t block_size, uint8_t blocks, const uint8_t *buf);
+
+ protected:
+  max3421e::MAX3421EComponent *parent_;
+};
+
+// USB mass storage device (e.g. a stick) on the MAX3421E with sequential block access and an append-only log.
+//
+// The log takes over a range of blocks of the device and ignores any filesystem on it. Data appended is collected
+// in one of two buffers while the other one is written, up to MAX3421E_MSC_LOOP_BLOCKS blocks per loop, so producers
+// never wait for the device. tools/read_usb_log.py extracts the data from the device or an image of it.
+class MSCComponent : public Component {
+ public:
+  void setup() override;
+  void loop() override;
+  void dump_config() override;
+  void on_shutdown() override;
+  float get_setup_priority() const override;
+
+  void set_parent(max3421e::MAX3421EComponent *parent) { this->parent_ = parent; }
+  void set_lun(uint8_t lun) { this->lun_ = lun; }
+  void set_buffer_blocks(uint8_t buffer_blocks) { this->buffer_blocks_ = buffer_blocks; }
+  // enable the log in the blocks [start, start + count), count 0 uses the rest of the device.
+  void set_log(uint32_t start, uint32_t count) {
+    this->log_ = true;
+    this->log_start_ = start;
+    this->log_count_ = count;
+  }
+  void set_flush_interval(uint32_t flush_interval) { this->flush_interval_ = flush_interval; }
+  void set_benchmark_blocks(uint32_t benchmark_blocks) { this->benchmark_blocks_ = benchmark_blocks; }
+  void set_benchmark_interval(uint32_t benchmark_interval) { this->benchmark_interval_ = benchmark_interval; }
+#ifdef USE_SENSOR
+  void set_log_size_sensor(sensor::Sensor *log_size_sensor) { this->log_size_sensor_ = log_size_sensor; }
+  void set_log_free_sensor(sensor::Sensor *log_free_sensor) { this->log_free_sensor_ = log_free_sensor; }
+  void set_dropped_sensor(sensor::Sensor *dropped_sensor) { this->dropped_sensor_ = dropped_sensor; }
+#endif
+
+  // true once the capacity of the device is known and the end of the log was found.
+  bool is_mounted() const { return this->mounted_; }
+  bool is_ready() { return this->mounted_ && this->is_present_() && !this->parent_->isSuspended(); }
+  uint32_t capacity() const { return this->capacity_; }
+  uint16_t block_size() const { return this->block_size_; }
+
+  // read or write count consecutive blocks starting at lba, returns the result code of the first failed transfer.
+  // Blocks within the log are overwritten without notice.
+  //   call only when is_ready()
+  uint8_t read_blocks(uint32_t lba, uint32_t count, uint8_t *buf);
+  uint8_t write_blocks(uint32_t lba, uint32_t count, const uint8_t *buf);
+
+  // append data to the log, returns the bytes taken. Data not fitting into the free buffer is dropped.
+  size_t append(const uint8_t *data, size_t len);
+  // write the buffered data to the device with the next loop instead of after the flush interval.
+  void flush() { this->flush_requested_ = true; }
+
+ protected:
+  bool is_present_() {
+    return this->msc_ != nullptr && this->msc_->GetAddress() != 0 && this->msc_->LUNIsGood(this->lun_);
+  }
+  size_t payload_size_() const { return this->block_size_ - sizeof(MSC_LOG_BLOCK_HEADER); }
+  size_t buffer_capacity_() const { return this->payload_size_() * this->buffer_blocks_; }
+  uint8_t *fill_buffer_() { return this->buffers_[this->fill_].data(); }
+  uint8_t *pending_buffer_() { return this->buffers_[this->fill_ ^ 1].data(); }
+  void alloc_buffers_(uint16_t block_size);
+
+  // function to read the capacity of the device and find the end of the log.
+  void mount_();
+  // function to find the last block of the log and where to continue it. Returns false to try again later.
+  bool open_log_();
+  // true if the block read into block_ belongs to the log at lba.
+  bool valid_block_(uint32_t lba) const;
+  // function to write up to max_blocks blocks of the buffer holding len bytes of data, starting with its block
+  // first, to the blocks at next_lba_ + first, filling in their headers. Sets the number of blocks written, which
+  // stops at the end of the log.
+  uint8_t write_log_(uint8_t *buf, size_t len, uint32_t first, uint32_t max_blocks, uint32_t *blocks);
+  // function to write the next blocks of the full buffer, after its last block next_lba_ moves on.
+  // Returns false if the transfer failed.
+  bool write_pending_();
+  // function to write the next blocks of the data in the fill buffer so far, starting with the first block not
+  // completely written. next_lba_ stays as the buffer will be written again. Returns false if the transfer failed.
+  bool flush_fill_();
+  // function to measure the throughput of writing and reading benchmark_blocks_ blocks behind the log.
+  void run_benchmark_();
+  // function to log the sustained throughput since the last report.
+  void report_benchmark_();
+  void publish_sensors_();
+
+  max3421e::MAX3421EComponent *parent_{nullptr};
+  StatsBulkOnly *msc_{nullptr};
+  uint8_t lun_{0};
+  bool mounted_{false};
+  // the device can't be used, e.g. because of its block size, until it is attached again
+  bool mount_failed_{false};
+  uint32_t retry_last_{0};
+  // the last write of the log failed, the next one waits for the retry interval
+  bool write_failed_{false};
+  uint32_t capacity_{0};
+  uint16_t block_size_{MAX3421E_MSC_MIN_BLOCK_SIZE};
+
+  bool log_{false};
+  bool log_opened_{false};
+  bool log_full_{false};
+  uint32_t log_start_{0};
+  uint32_t log_count_{0};
+  uint32_t log_end_{0};
+  uint32_t log_id_{0};
+  // block the first block of the pending buffer, or the fill buffer if there is none, goes to
+  uint32_t next_lba_{0};
+  uint32_t flush_interval_{10000};
+  uint32_t flush_last_{0};
+  bool flush_requested_{false};
+
+  uint8_t buffer_blocks_{8};
+  std::vector<uint8_t> buffers_[2];
+  // a single block read while opening the log
+  std::vector<uint8_t> block_;
+  uint8_t fill_{0};
+  size_t fill_len_{0};     // data in the fill buffer
+  size_t flushed_len_{0};  // data of the fill buffer already on the device
+  size_t pending_len_{0};  // data in the full buffer waiting to be written, 0 if there is none
+  uint32_t fill_done_{0};     // full blocks at the start of the fill buffer already on the device
+  uint32_t pending_done_{0};  // blocks at the start of the pending buffer already on the device
+  bool overflow_{false};
+  uint32_t dropped_{0};
+
+  uint32_t benchmark_blocks_{0};
+  bool benchmark_done_{false};
+  uint32_t benchmark_interval_{0};
+  uint32_t benchmark_last_{0};
+  uint32_t written_bytes_{0};
+  uint32_t write_transfers_{0};
+  uint32_t dropped_last_{0};
+  uint32_t busy_us_{0};  // time spent in transfers
+
+#ifdef USE_SENSOR
+  sensor::Sensor *log_size_sensor_{nullptr};
+  sensor::Sensor *log_free_sensor_{nullptr};
+  sensor::Sensor *dropped_sensor_{nullptr};
+#endif
+};
+
+template<typename... Ts> class AppendAction : public Action<Ts...>, public Parented<MSCComponent> {
+ public:
+  TEMPLATABLE_VALUE(std::string, data)
+
+  void play(Ts... x) override {
+    std::string data = this->data_.value(x...);
+    this->parent_->append((const uint8_t *) data.data(), data.size());
+  }
+};
+
+template<typename... Ts> class FlushAction : public Action<Ts...>, public Parented<MSCComponent> {
+ public:
+  void play(Ts... x) override { this->parent_->flush(); }
+};
+
+}  // namespace max3421e_msc
+}  // namespace esphome
@@ -0,0 +1,57 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    DEVICE_CLASS_DATA_SIZE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_BYTES,
+)
+
+from . import CONF_MAX3421E_MSC_ID, MSCComponent
+
+DEPENDENCIES = ["max3421e_msc", "sensor"]
+
+CONF_LOG_SIZE = "log_size"
+CONF_LOG_FREE = "log_free"
+CONF_DROPPED = "dropped"
+
+CONFIG_SCHEMA = cv.Schema({
+    cv.GenerateID(CONF_MAX3421E_MSC_ID): cv.use_id(MSCComponent),
+    cv.Optional(CONF_LOG_SIZE): sensor.sensor_schema(
+        unit_of_measurement=UNIT_BYTES,
+        accuracy_decimals=0,
+        device_class=DEVICE_CLASS_DATA_SIZE,
+        state_class=STATE_CLASS_MEASUREMENT,
+        icon="mdi:usb-flash-drive",
+    ),
+    cv.Optional(CONF_LOG_FREE): sensor.sensor_schema(
+        unit_of_measurement=UNIT_BYTES,
+        accuracy_decimals=0,
+        device_class=DEVICE_CLASS_DATA_SIZE,
+        state_class=STATE_CLASS_MEASUREMENT,
+        icon="mdi:usb-flash-drive-outline",
+    ),
+    cv.Optional(CONF_DROPPED): sensor.sensor_schema(
+        unit_of_measurement=UNIT_BYTES,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:delete-alert-outline",
+    ),
+})
+
+
+async def to_code(config):
+    component = await cg.get_variable(config[CONF_MAX3421E_MSC_ID])
+
+    if CONF_LOG_SIZE in config:
+        var = await sensor.new_sensor(config[CONF_LOG_SIZE])
+        cg.add(component.set_log_size_sensor(var))
+    if CONF_LOG_FREE in config:
+        var = await sensor.new_sensor(config[CONF_LOG_FREE])
+        cg.add(component.set_log_free_sensor(var))
+    if CONF_DROPPED in config:
+        var = await sensor.new_sensor(config[CONF_DROPPED])
+        cg.add(component.set_dropped_sensor(var))
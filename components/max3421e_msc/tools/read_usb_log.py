@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Extract the data of the max3421e_msc log from a USB stick or an image of it.
+
+Usage: read_usb_log.py DEVICE_OR_IMAGE START_BLOCK [OUTPUT]   (writes stdout without OUTPUT)
+
+START_BLOCK and the block size (512 bytes, see --block-size) have to match the log configuration.
+Reads blocks until the first one not belonging to the log, e.g.
+
+    sudo python3 read_usb_log.py /dev/sdb 2048 sensors.bin
+"""
+import argparse
+import struct
+import sys
+
+MAGIC = 0x474F4C55
+HEADER = struct.Struct("<IIIHH")
+
+
+def crc16(data):
+    # crc16 of esphome/core/helpers.h with its defaults (MODBUS)
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def read_log(src, start, block_size, out):
+    src.seek(start * block_size)
+    log_id = None
+    index = 0
+    size = 0
+    while True:
+        block = src.read(block_size)
+        if len(block) < block_size:
+            break
+        magic, block_log_id, block_index, used, crc = HEADER.unpack_from(block)
+        if log_id is None:
+            log_id = block_log_id
+        data = block[HEADER.size:HEADER.size + used]
+        if (magic != MAGIC or block_log_id != log_id or block_index != index or
+                used > block_size - HEADER.size or crc16(data) != crc):
+            break
+        out.write(data)
+        size += used
+        index += 1
+    return log_id, index, size
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="block device or image of it")
+    parser.add_argument("start_block", type=int, help="start_block of the log configuration")
+    parser.add_argument("output", nargs="?", help="file to write the data to, stdout without it")
+    parser.add_argument("--block-size", type=int, default=512, help="block size of the device, defaults to 512")
+    args = parser.parse_args()
+
+    with open(args.source, "rb") as src:
+        if args.output:
+            with open(args.output, "wb") as out:
+                log_id, blocks, size = read_log(src, args.start_block, args.block_size, out)
+        else:
+            log_id, blocks, size = read_log(src, args.start_block, args.block_size, sys.stdout.buffer)
+    if blocks == 0:
+        print("No log found", file=sys.stderr)
+        return 1
+    print(f"Log {log_id:08X}: {size} bytes in {blocks} blocks", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,114 @@
+// Microbenchmark of DescriptorRange against the unchecked pointer walk dumpDevFullConfDesc did before, on the
+// well-formed configurations of the corpus. Build it optimized and without sanitizers (the default of the
+// CMake target), then:
+//
+//   descriptors_bench corpus/ [iterations]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "max3421e_descriptors.h"
+
+using esphome::max3421e::DescriptorRange;
+using esphome::max3421e::DescriptorView;
+
+namespace {
+
+// keeps the compiler from dropping the work measured
+volatile uint32_t sink;
+
+// interfaces and endpoints counted the way the old dump walked the buffer, trusting every bLength.
+uint32_t raw_walk(const uint8_t *buf, size_t len) {
+  uint32_t found = 0;
+  const uint8_t *ptr = buf;
+  while (ptr < buf + len) {
+    uint8_t desc_len = ptr[0];
+    if (desc_len == 0) {
+      break;  // the old walk looped forever here, the corpus only holds valid inputs anyway
+    }
+    if (ptr[1] == USB_DESCRIPTOR_INTERFACE) {
+      found += reinterpret_cast<const USB_INTERFACE_DESCRIPTOR *>(ptr)->bNumEndpoints;
+    } else if (ptr[1] == USB_DESCRIPTOR_ENDPOINT) {
+      found += reinterpret_cast<const USB_ENDPOINT_DESCRIPTOR *>(ptr)->bEndpointAddress;
+    }
+    ptr += desc_len;
+  }
+  return found;
+}
+
+uint32_t range_walk(const uint8_t *buf, size_t len) {
+  uint32_t found = 0;
+  for (const DescriptorView &desc : DescriptorRange(buf, len)) {
+    if (const auto *intf = desc.as<USB_INTERFACE_DESCRIPTOR>()) {
+      found += intf->bNumEndpoints;
+    } else if (const auto *ep = desc.as<USB_ENDPOINT_DESCRIPTOR>()) {
+      found += ep->bEndpointAddress;
+    }
+  }
+  return found;
+}
+
+// what a class driver does when a device is attached: find its interface and endpoints.
+uint32_t range_lookup(const uint8_t *buf, size_t len) {
+  DescriptorRange descs(buf, len);
+  uint32_t found = 0;
+  for (const DescriptorView &desc : descs) {
+    const auto *intf = desc.as<USB_INTERFACE_DESCRIPTOR>();
+    if (intf == nullptr) {
+      continue;
+    }
+    intf = descs.find_interface(intf->bInterfaceClass, intf->bInterfaceSubClass, intf->bInterfaceProtocol);
+    for (uint8_t type = USB_TRANSFER_TYPE_BULK; type <= USB_TRANSFER_TYPE_INTERRUPT; type++) {
+      if (const auto *ep = descs.find_endpoint(intf, type, true)) {
+        found += ep->bEndpointAddress;
+      }
+      if (const auto *ep = descs.find_endpoint(intf, type, false)) {
+        found += ep->bEndpointAddress;
+      }
+    }
+  }
+  return found;
+}
+
+double bench(uint32_t (*func)(const uint8_t *, size_t), const std::vector<uint8_t> &input, unsigned long iterations) {
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++) {
+    sink = sink + func(input.data(), input.size());
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s CORPUS_DIR [ITERATIONS]\n", argv[0]);
+    return 1;
+  }
+  unsigned long iterations = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+  if (iterations == 0) {
+    iterations = 1;
+  }
+
+  printf("%-24s %6s %12s %12s %12s\n", "input", "bytes", "raw ns", "range ns", "lookup ns");
+  for (const auto &entry : std::filesystem::directory_iterator(argv[1])) {
+    std::ifstream file(entry.path(), std::ios::binary);
+    std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    // the raw walk reads past malformed inputs
+    if (input.empty() || !DescriptorRange(input).valid()) {
+      continue;
+    }
+    printf("%-24s %6zu %12.1f %12.1f %12.1f\n", entry.path().stem().c_str(), input.size(),
+           bench(raw_walk, input, iterations), bench(range_walk, input, iterations),
+           bench(range_lookup, input, iterations));
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+// Fuzz target for DescriptorRange, DescriptorIterator and DescriptorView of max3421e_descriptors.h: whatever the
+// input, every descriptor and typed pointer handed out has to lie within it. Built with libFuzzer when the compiler
+// supports it, otherwise with fuzz_main.cpp, which replays and mutates the corpus. Violations abort, reads past the
+// input are caught by ASan.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "max3421e_descriptors.h"
+
+using esphome::max3421e::DescriptorRange;
+using esphome::max3421e::DescriptorView;
+using esphome::max3421e::DESCRIPTOR_MATCH_ANY;
+
+namespace {
+
+void check(bool condition) {
+  if (!condition) {
+    abort();
+  }
+}
+
+void check_inside(const void *ptr, size_t len, const uint8_t *begin, const uint8_t *end) {
+  const auto *data = static_cast<const uint8_t *>(ptr);
+  check(data >= begin && data + len <= end);
+}
+
+template<typename T> void check_as(const DescriptorView &desc, const uint8_t *begin, const uint8_t *end) {
+  if (const T *typed = desc.as<T>()) {
+    check(desc.length() >= sizeof(T));
+    check_inside(typed, sizeof(T), begin, end);
+  }
+}
+
+// walks the range and checks each descriptor, returns the bytes walked.
+size_t walk(const DescriptorRange &range, const uint8_t *begin, const uint8_t *end) {
+  size_t walked = 0;
+  for (const DescriptorView &desc : range) {
+    check(desc.length() >= 2);
+    check_inside(desc.data(), desc.length(), begin, end);
+    check_as<USB_CONFIGURATION_DESCRIPTOR>(desc, begin, end);
+    check_as<USB_INTERFACE_DESCRIPTOR>(desc, begin, end);
+    check_as<USB_ENDPOINT_DESCRIPTOR>(desc, begin, end);
+    check_as<HubDescriptor>(desc, begin, end);
+    walked += desc.length();
+  }
+  check(walked <= range.size());
+  check(range.valid() == (walked == range.size()));
+  return walked;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  // a buffer of the exact size, so ASan catches reads past its end
+  std::vector<uint8_t> buf(data, data + size);
+  const uint8_t *begin = buf.data();
+  const uint8_t *end = begin + size;
+  DescriptorRange range(buf);
+  walk(range, begin, end);
+
+  for (uint8_t index = 0; index < 4; index++) {
+    DescriptorRange conf = range.configuration(index);
+    check(conf.size() <= size);
+    walk(conf, begin, end);
+  }
+
+  const USB_INTERFACE_DESCRIPTOR *first = range.find_interface(DESCRIPTOR_MATCH_ANY);
+  check(first == range.first<USB_INTERFACE_DESCRIPTOR>());
+  check(range.interface_descriptors(nullptr).size() == 0);
+  for (const DescriptorView &desc : range) {
+    const auto *intf = desc.as<USB_INTERFACE_DESCRIPTOR>();
+    if (intf == nullptr) {
+      continue;
+    }
+    check(range.find_interface(intf->bInterfaceClass, intf->bInterfaceSubClass, intf->bInterfaceProtocol) != nullptr);
+    walk(range.interface_descriptors(intf), begin, end);
+    for (uint8_t type = USB_TRANSFER_TYPE_CONTROL; type <= USB_TRANSFER_TYPE_INTERRUPT; type++) {
+      for (bool in : {false, true}) {
+        const USB_ENDPOINT_DESCRIPTOR *ep = range.find_endpoint(intf, type, in);
+        if (ep != nullptr) {
+          check_inside(ep, sizeof(*ep), begin, end);
+          check((ep->bmAttributes & bmUSB_TRANSFER_TYPE) == type);
+          check(((ep->bEndpointAddress & 0x80) != 0) == in);
+        }
+      }
+    }
+  }
+  return 0;
+}
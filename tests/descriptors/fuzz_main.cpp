@@ -0,0 +1,107 @@
+// Stands in for libFuzzer with compilers lacking -fsanitize=fuzzer (e.g. gcc): runs the fuzz target on every file
+// given, or every file in the directories given, then on -runs=N mutations of them. Mutations are seeded, so a
+// failing run can be repeated with the same arguments.
+//
+//   descriptors_fuzz corpus/ -runs=100000
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace {
+
+// longer than any configuration summary kept per device (MAX3421E_MAX_CONF_SUMMARY_LEN)
+const size_t MAX_INPUT_LEN = 1024;
+
+uint32_t rng_state = 0x12345678;
+
+uint32_t next_random() {
+  // xorshift32
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+std::vector<uint8_t> read_file(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void mutate(std::vector<uint8_t> &data) {
+  // bytes a descriptor parser is sensitive to: lengths around the struct sizes and the descriptor types
+  static const uint8_t INTERESTING[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0x21, 0x24, 0x29, 0x7F, 0x80, 0xFF};
+  switch (next_random() % 5) {
+    case 0:
+      if (!data.empty()) {
+        data[next_random() % data.size()] ^= 1 << (next_random() % 8);
+      }
+      break;
+    case 1:
+      if (!data.empty()) {
+        data[next_random() % data.size()] = INTERESTING[next_random() % sizeof(INTERESTING)];
+      }
+      break;
+    case 2:
+      data.resize(data.empty() ? 0 : next_random() % data.size());
+      break;
+    case 3:
+      if (data.size() < MAX_INPUT_LEN) {
+        data.insert(data.begin() + (data.empty() ? 0 : next_random() % data.size()), next_random() & 0xFF);
+      }
+      break;
+    default:
+      if (!data.empty() && data.size() * 2 <= MAX_INPUT_LEN) {
+        // a copy of a tail, e.g. another configuration or interface
+        size_t from = next_random() % data.size();
+        data.insert(data.end(), data.begin() + from, data.end());
+      }
+      break;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::vector<uint8_t>> corpus;
+  unsigned long runs = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "-runs=", 6) == 0) {
+      runs = strtoul(argv[i] + 6, nullptr, 10);
+    } else if (strncmp(argv[i], "-seed=", 6) == 0) {
+      rng_state = strtoul(argv[i] + 6, nullptr, 10) | 1;
+    } else if (std::filesystem::is_directory(argv[i])) {
+      for (const auto &entry : std::filesystem::directory_iterator(argv[i])) {
+        if (entry.is_regular_file()) {
+          corpus.push_back(read_file(entry.path()));
+        }
+      }
+    } else {
+      corpus.push_back(read_file(argv[i]));
+    }
+  }
+  if (corpus.empty()) {
+    corpus.emplace_back();
+  }
+
+  for (const auto &input : corpus) {
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+  }
+  for (unsigned long run = 0; run < runs; run++) {
+    std::vector<uint8_t> input = corpus[next_random() % corpus.size()];
+    for (uint32_t n = 1 + next_random() % 8; n > 0; n--) {
+      mutate(input);
+    }
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+  }
+  printf("Done %zu inputs and %lu mutations\n", corpus.size(), runs);
+  return 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// The parts of Usb.h (usb_ch9.h) of the USB Host Shield library used by max3421e_descriptors.h, with the same
+// names and packed layout, so the descriptor iterator builds on the host without the Arduino core.
+
+#include <cstdint>
+
+#define USB_DESCRIPTOR_DEVICE 0x01
+#define USB_DESCRIPTOR_CONFIGURATION 0x02
+#define USB_DESCRIPTOR_STRING 0x03
+#define USB_DESCRIPTOR_INTERFACE 0x04
+#define USB_DESCRIPTOR_ENDPOINT 0x05
+
+#define USB_TRANSFER_TYPE_CONTROL 0x00
+#define USB_TRANSFER_TYPE_ISOCHRONOUS 0x01
+#define USB_TRANSFER_TYPE_BULK 0x02
+#define USB_TRANSFER_TYPE_INTERRUPT 0x03
+#define bmUSB_TRANSFER_TYPE 0x03
+
+#define USB_CLASS_CDC_CONTROL 0x02
+#define USB_CLASS_HID 0x03
+#define USB_CLASS_MASS_STORAGE 0x08
+#define USB_CLASS_HUB 0x09
+#define USB_CLASS_CDC_DATA 0x0A
+
+typedef struct {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint16_t wTotalLength;
+  uint8_t bNumInterfaces;
+  uint8_t bConfigurationValue;
+  uint8_t iConfiguration;
+  uint8_t bmAttributes;
+  uint8_t bMaxPower;
+} __attribute__((packed)) USB_CONFIGURATION_DESCRIPTOR;
+
+typedef struct {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint8_t bInterfaceNumber;
+  uint8_t bAlternateSetting;
+  uint8_t bNumEndpoints;
+  uint8_t bInterfaceClass;
+  uint8_t bInterfaceSubClass;
+  uint8_t bInterfaceProtocol;
+  uint8_t iInterface;
+} __attribute__((packed)) USB_INTERFACE_DESCRIPTOR;
+
+typedef struct {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint8_t bEndpointAddress;
+  uint8_t bmAttributes;
+  uint16_t wMaxPacketSize;
+  uint8_t bInterval;
+} __attribute__((packed)) USB_ENDPOINT_DESCRIPTOR;
@@ -0,0 +1,23 @@
+#pragma once
+
+// HubDescriptor of usbhub.h of the USB Host Shield library, see Usb.h.
+
+#include <cstdint>
+
+struct HubDescriptor {
+  uint8_t bDescLength;
+  uint8_t bDescriptorType;
+  uint8_t bNbrPorts;
+
+  struct {
+    uint16_t LogPwrSwitchMode : 2;
+    uint16_t CompoundDevice : 1;
+    uint16_t OverCurrentProtectMode : 2;
+    uint16_t TTThinkTime : 2;
+    uint16_t PortIndicatorsSupported : 1;
+    uint8_t Reserved : 8;
+  } __attribute__((packed));
+
+  uint8_t bPwrOn2PwrGood;
+  uint8_t bHubContrCurrent;
+} __attribute__((packed));
@@ -0,0 +1,67 @@
+#include "msc_emulator.h"
+
+#include <cstring>
+
+#include "esphome/core/application.h"
+#include "esphome/core/hal.h"
+#include "masstorage.h"
+
+namespace msc_emulator {
+
+Disk disk;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+// the component waits a second after boot before mounting
+static uint64_t clock_us = 10000000;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+void reset(uint32_t blocks, uint16_t block_size) {
+  disk = Disk{};
+  disk.block_size = block_size;
+  disk.blocks = blocks;
+  disk.data.assign((size_t) blocks * block_size, 0);
+}
+
+void advance_us(uint64_t us) { clock_us += us; }
+
+uint64_t now_us() { return clock_us; }
+
+static uint8_t transfer(uint32_t lba, uint16_t block_size, uint8_t blocks) {
+  if (block_size != disk.block_size || (uint64_t) lba + blocks > disk.blocks) {
+    return 0x0D;  // MASS_ERR_INVALID_LBA
+  }
+  disk.commands++;
+  advance_us(COMMAND_US + (uint64_t) (blocks * block_size * DATA_US_PER_BYTE));
+  return 0;
+}
+
+}  // namespace msc_emulator
+
+namespace esphome {
+
+Application App;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+uint32_t millis() { return msc_emulator::now_us() / 1000; }
+uint32_t micros() { return msc_emulator::now_us(); }
+
+}  // namespace esphome
+
+uint8_t BulkOnly::Read(uint8_t lun, uint32_t addr, uint16_t bsize, uint8_t blocks, uint8_t *buf) {
+  uint8_t rcode = msc_emulator::transfer(addr, bsize, blocks);
+  if (rcode == 0) {
+    memcpy(buf, msc_emulator::disk.data.data() + (size_t) addr * bsize, (size_t) blocks * bsize);
+    msc_emulator::disk.read_bytes += (size_t) blocks * bsize;
+  }
+  return rcode;
+}
+
+uint8_t BulkOnly::Write(uint8_t lun, uint32_t addr, uint16_t bsize, uint8_t blocks, const uint8_t *buf) {
+  uint8_t rcode = msc_emulator::transfer(addr, bsize, blocks);
+  if (rcode == 0) {
+    memcpy(msc_emulator::disk.data.data() + (size_t) addr * bsize, buf, (size_t) blocks * bsize);
+    msc_emulator::disk.written_bytes += (size_t) blocks * bsize;
+  }
+  return rcode;
+}
+
+uint32_t BulkOnly::GetCapacity(uint8_t lun) { return msc_emulator::disk.blocks; }
+
+uint16_t BulkOnly::GetSectorSize(uint8_t lun) { return msc_emulator::disk.block_size; }
@@ -0,0 +1,33 @@
+#pragma once
+
+// RAM disk behind the BulkOnly stub and the virtual clock of millis() and micros(). Transfers advance the clock by
+// a rough model of a USB stick on the MAX3421E at full speed: a fixed time for the command and status stages plus
+// the data at about 600kB/s.
+
+#include <cstdint>
+#include <vector>
+
+namespace msc_emulator {
+
+// time of the command and status stages and the stick, per SCSI command
+const uint32_t COMMAND_US = 1000;
+// data stage, 64 byte packets at full speed with the SPI overhead of the MAX3421E
+const double DATA_US_PER_BYTE = 1.6;
+
+struct Disk {
+  std::vector<uint8_t> data;
+  uint16_t block_size{512};
+  uint32_t blocks{0};
+  uint64_t read_bytes{0};
+  uint64_t written_bytes{0};
+  uint32_t commands{0};
+};
+
+extern Disk disk;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+// empty the disk, the clock keeps running.
+void reset(uint32_t blocks, uint16_t block_size);
+void advance_us(uint64_t us);
+uint64_t now_us();
+
+}  // namespace msc_emulator
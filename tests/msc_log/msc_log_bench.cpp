@@ -0,0 +1,175 @@
+// Benchmark of the append-only log of max3421e_msc on a RAM disk with the timing of a USB stick (msc_emulator.h).
+// Each scenario appends data at a fixed rate from the loop, then flushes and checks that every byte appended is
+// either in the log read back from the disk or counted as dropped. Reports the longest time a single loop spent in
+// transfers and the bytes written to the disk per byte logged. Exits with 1 if a check fails.
+//
+//   msc_log_bench [seconds]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "esphome/core/helpers.h"
+#include "max3421e_msc.h"
+#include "msc_emulator.h"
+
+using esphome::max3421e::MAX3421EComponent;
+using esphome::max3421e_msc::MSC_LOG_BLOCK_HEADER;
+using esphome::max3421e_msc::MSCComponent;
+
+// like on the node, the component keeps the driver it registered at the USB host until the end
+extern "C" const char *__asan_default_options() { return "detect_leaks=0"; }  // NOLINT
+
+namespace {
+
+// interval the main loop runs at
+const uint32_t LOOP_US = 1000;
+const uint32_t LOG_START = 64;
+const uint32_t DISK_BLOCKS = 65536;
+
+struct Scenario {
+  const char *name;
+  uint8_t buffer_blocks;
+  uint32_t flush_interval_ms;
+  uint32_t append_len;        // bytes per append
+  uint32_t append_period_us;  // time between appends
+  uint32_t log_blocks;        // 0 for the rest of the disk
+  bool reboot;                // continue the log of the previous scenario
+};
+
+struct Result {
+  uint64_t appended{0};
+  uint64_t dropped{0};
+  uint64_t disk_written{0};
+  uint32_t commands{0};
+  uint32_t longest_loop_us{0};
+  uint64_t busy_us{0};
+};
+
+// the log as tools/read_usb_log.py extracts it: the data of the valid blocks from the start of the log.
+std::vector<uint8_t> read_log() {
+  const auto &disk = msc_emulator::disk;
+  std::vector<uint8_t> data;
+  uint32_t log_id = 0;
+  for (uint32_t lba = LOG_START; lba < disk.blocks; lba++) {
+    const uint8_t *block = disk.data.data() + (size_t) lba * disk.block_size;
+    MSC_LOG_BLOCK_HEADER header;
+    memcpy(&header, block, sizeof(header));
+    if (lba == LOG_START) {
+      log_id = header.log_id;
+    }
+    if (header.magic != MAX3421E_MSC_LOG_MAGIC || header.log_id != log_id || header.index != lba - LOG_START ||
+        header.used > disk.block_size - sizeof(header) ||
+        header.crc != esphome::crc16(block + sizeof(header), header.used)) {
+      break;
+    }
+    data.insert(data.end(), block + sizeof(header), block + sizeof(header) + header.used);
+  }
+  return data;
+}
+
+// runs the loop for the given time, appending from it while append is set.
+void run(MSCComponent &msc, MAX3421EComponent &parent, const Scenario &scenario, uint64_t duration_us, bool append,
+         std::vector<uint8_t> &taken, Result &result, uint32_t &counter) {
+  uint64_t end = msc_emulator::now_us() + duration_us;
+  uint64_t next_append = msc_emulator::now_us();
+  std::vector<uint8_t> chunk(scenario.append_len);
+  while (msc_emulator::now_us() < end) {
+    uint64_t loop_start = msc_emulator::now_us();
+    while (append && next_append <= loop_start) {
+      for (auto &c : chunk) {
+        c = counter++ * 31 + 7;  // position dependent, so lost or repeated data shows up
+      }
+      size_t n = msc.append(chunk.data(), chunk.size());
+      taken.insert(taken.end(), chunk.begin(), chunk.begin() + n);
+      result.appended += chunk.size();
+      next_append += scenario.append_period_us;
+    }
+    uint32_t busy = parent.getStats()->busy_us;
+    msc.loop();
+    uint32_t loop_busy = parent.getStats()->busy_us - busy;
+    result.longest_loop_us = std::max(result.longest_loop_us, loop_busy);
+    result.busy_us += loop_busy;
+    uint64_t elapsed = msc_emulator::now_us() - loop_start;
+    msc_emulator::advance_us(elapsed < LOOP_US ? LOOP_US - elapsed : 0);
+  }
+}
+
+bool run_scenario(const Scenario &scenario, uint32_t seconds, std::vector<uint8_t> &expected, uint32_t &counter) {
+  if (!scenario.reboot) {
+    msc_emulator::reset(DISK_BLOCKS, 512);
+    expected.clear();
+  }
+  MAX3421EComponent parent;
+  MSCComponent msc;
+  esphome::sensor::Sensor dropped;
+  msc.set_parent(&parent);
+  msc.set_buffer_blocks(scenario.buffer_blocks);
+  msc.set_log(LOG_START, scenario.log_blocks);
+  msc.set_flush_interval(scenario.flush_interval_ms);
+  msc.set_dropped_sensor(&dropped);
+  msc.setup();
+
+  Result result;
+  uint64_t disk_written = msc_emulator::disk.written_bytes;
+  uint32_t commands = msc_emulator::disk.commands;
+  std::vector<uint8_t> taken;
+  run(msc, parent, scenario, (uint64_t) seconds * 1000000, true, taken, result, counter);
+  // everything buffered reaches the disk within two flush intervals
+  msc.flush();
+  run(msc, parent, scenario, (uint64_t) scenario.flush_interval_ms * 2000, false, taken, result, counter);
+  result.dropped = (uint64_t) dropped.state;
+  result.disk_written = msc_emulator::disk.written_bytes - disk_written;
+  result.commands = msc_emulator::disk.commands - commands;
+
+  std::vector<uint8_t> log = read_log();
+  expected.insert(expected.end(), taken.begin(), taken.end());
+  // with the log full, the data taken last didn't fit
+  bool ok = msc.is_mounted() && log.size() <= expected.size() && std::equal(log.begin(), log.end(), expected.begin());
+  uint64_t logged = log.size() - (expected.size() - taken.size());
+  ok = ok && logged + result.dropped == result.appended;
+
+  double simulated = seconds + scenario.flush_interval_ms * 2 / 1000.0;
+  printf("%-26s %10.1f %10.1f %10llu %8.2f %8u %10.2f %7.1f%%  %s\n", scenario.name,
+         result.appended / 1000.0 / seconds, logged / 1000.0, (unsigned long long) result.dropped,
+         logged > 0 ? (double) result.disk_written / logged : 0.0, (unsigned) result.commands,
+         result.longest_loop_us / 1000.0, result.busy_us / 10000.0 / simulated, ok ? "ok" : "FAILED");
+  if (!ok) {
+    fprintf(stderr, "%s: %zu bytes in the log, %zu expected, %llu dropped of %llu appended\n", scenario.name,
+            log.size(), expected.size(), (unsigned long long) result.dropped,
+            (unsigned long long) result.appended);
+  }
+  // the next scenario continues from what is on the disk
+  expected = log;
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  uint32_t seconds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 60;
+  if (seconds == 0) {
+    seconds = 1;
+  }
+  static const Scenario SCENARIOS[] = {
+      {"steady 10kB/s", 8, 1000, 100, 10000, 0, false},
+      {"steady 10kB/s, reboot", 8, 1000, 100, 10000, 0, true},
+      {"steady 10kB/s, 64 blocks", 64, 1000, 100, 10000, 0, false},
+      {"burst 200kB/s, 64 blocks", 64, 10000, 200, 1000, 0, false},
+      {"overload 1MB/s", 8, 1000, 1000, 1000, 0, false},
+      {"log full", 8, 1000, 100, 1000, 64, false},
+  };
+
+  printf("%-26s %10s %10s %10s %8s %8s %10s %8s\n", "scenario", "kB/s", "logged kB", "dropped", "written", "commands",
+         "loop ms", "busy");
+  std::vector<uint8_t> expected;
+  uint32_t counter = 0;
+  bool ok = true;
+  for (const auto &scenario : SCENARIOS) {
+    ok = run_scenario(scenario, seconds, expected, counter) && ok;
+  }
+  return ok ? 0 : 1;
+}
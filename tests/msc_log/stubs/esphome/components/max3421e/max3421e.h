@@ -0,0 +1,39 @@
+#pragma once
+
+// The parts of the max3421e component used by max3421e_msc. The bus is never suspended.
+
+#include <cstdint>
+
+#include "esphome/core/hal.h"
+
+class USB {};
+
+namespace esphome {
+namespace max3421e {
+
+static const uint8_t STATS_ENDPOINT_IN = 0x80;
+
+class TransferStats {
+ public:
+  void record_since(uint8_t addr, uint8_t ep, uint8_t rcode, uint32_t bytes, uint32_t started) {
+    this->transfers++;
+    this->busy_us += micros() - started;
+  }
+  uint32_t transfers{0};
+  uint32_t busy_us{0};
+};
+
+class MAX3421EComponent {
+ public:
+  USB *getUsb() { return &this->usb_; }
+  TransferStats *getStats() { return &this->stats_; }
+  bool isSuspended() { return false; }
+  void requestResume() {}
+
+ protected:
+  USB usb_;
+  TransferStats stats_;
+};
+
+}  // namespace max3421e
+}  // namespace esphome
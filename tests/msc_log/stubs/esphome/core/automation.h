@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+namespace esphome {
+
+template<typename T> class Parented {
+ protected:
+  T *parent_{nullptr};
+};
+
+template<typename... Ts> class Action {
+ public:
+  virtual ~Action() = default;
+  virtual void play(Ts... x) = 0;
+};
+
+template<typename T, typename... X> class TemplatableValue {
+ public:
+  T value(X... x) { return T(); }
+};
+
+#define TEMPLATABLE_VALUE(type, name) \
+ protected: \
+  TemplatableValue<type, Ts...> name##_{}; \
+\
+ public: \
+  template<typename V> void set_##name(V name) {}
+
+}  // namespace esphome
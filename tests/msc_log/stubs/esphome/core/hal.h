@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+
+// the virtual clock of the emulator, advanced by the loop of the benchmark and by transfers.
+uint32_t millis();
+uint32_t micros();
+
+}  // namespace esphome
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+
+// same algorithm and defaults as helpers.cpp of ESPHome (CRC-16/MODBUS).
+inline uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc = 0xffff, uint16_t reverse_poly = 0xa001,
+                      bool refin = false, bool refout = false) {
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      crc = (crc & 1) ? (crc >> 1) ^ reverse_poly : crc >> 1;
+    }
+  }
+  return crc;
+}
+
+inline uint32_t random_uint32() { return 0x5EED1234; }
+
+}  // namespace esphome
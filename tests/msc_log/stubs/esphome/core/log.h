@@ -0,0 +1,11 @@
+#pragma once
+
+// log output would dominate the benchmark, the arguments are still checked against the format.
+__attribute__((format(printf, 1, 2))) inline void esp_log_discard(const char *format, ...) {}
+
+#define ESP_LOGE(tag, ...) esp_log_discard(__VA_ARGS__)
+#define ESP_LOGW(tag, ...) esp_log_discard(__VA_ARGS__)
+#define ESP_LOGI(tag, ...) esp_log_discard(__VA_ARGS__)
+#define ESP_LOGD(tag, ...) esp_log_discard(__VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) esp_log_discard(__VA_ARGS__)
+#define LOG_SENSOR(prefix, type, obj) (void) (obj)
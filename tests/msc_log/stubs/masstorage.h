@@ -0,0 +1,33 @@
+#pragma once
+
+// BulkOnly of masstorage.h of the USB Host Shield library, backed by the RAM disk of msc_emulator.h.
+
+#include <cstdint>
+
+class USB;
+
+#define MASS_ERR_DEVICE_DISCONNECTED 0x11
+
+struct EpInfo {
+  uint8_t epAddr;
+};
+
+class BulkOnly {
+ public:
+  explicit BulkOnly(USB *p) {}
+  virtual ~BulkOnly() = default;
+
+  uint8_t Read(uint8_t lun, uint32_t addr, uint16_t bsize, uint8_t blocks, uint8_t *buf);
+  uint8_t Write(uint8_t lun, uint32_t addr, uint16_t bsize, uint8_t blocks, const uint8_t *buf);
+  bool LUNIsGood(uint8_t lun) { return lun == 0; }
+  bool WriteProtected(uint8_t lun) { return false; }
+  uint32_t GetCapacity(uint8_t lun);
+  uint16_t GetSectorSize(uint8_t lun);
+  virtual uint8_t GetAddress() { return this->bAddress; }
+
+ protected:
+  static const uint8_t epDataInIndex = 1;
+  static const uint8_t epDataOutIndex = 2;
+  uint8_t bAddress{1};
+  EpInfo epInfo[3]{{0x00}, {0x81}, {0x02}};
+};